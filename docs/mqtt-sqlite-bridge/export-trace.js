@@ -0,0 +1,104 @@
+/**
+ * Export recorded sensor readings as a replay trace for the firmware
+ * Usage:
+ *   node export-trace.js <device_id> <out.trace> [first_batch] [last_batch]
+ *   node export-trace.js --csv <readings.csv> <out.trace>
+ *
+ * The CSV needs a header row with x, y, z and sample_rate_hz columns, e.g.
+ *   sqlite3 -csv -header driving_monitor.db \
+ *     "SELECT x, y, z, sample_rate_hz FROM sensor_readings ORDER BY batch_id, sample_index"
+ *
+ * Trace layout (little-endian, see src/sensor/replay.h):
+ *   "DSMT", u16 version, u16 sample_rate_hz, f32 accel_lsb_per_g, u32 count,
+ *   then count x int16 [x, y, z]
+ *
+ * Flash it with:
+ *   parttool.py write_partition --partition-name trace --input <out.trace>
+ */
+
+const fs = require('fs');
+const config = require('./src/config');
+
+const TRACE_VERSION = 1;
+const HEADER_SIZE = 16;
+const TRACE_PARTITION_SIZE = 0x270000; // partitions.csv
+
+function readFromDatabase(deviceId, firstBatch, lastBatch) {
+    const Database = require('better-sqlite3');
+    const db = new Database(config.database.filename, { readonly: true });
+    return db.prepare(`
+        SELECT x, y, z, sample_rate_hz FROM sensor_readings
+        WHERE device_id = ? AND batch_id BETWEEN ? AND ?
+        ORDER BY batch_id, sample_index
+    `).all(deviceId, firstBatch, lastBatch);
+}
+
+function readFromCsv(file) {
+    const [header, ...lines] = fs.readFileSync(file, 'utf8').trim().split(/\r?\n/);
+    const columns = header.split(',').map(c => c.trim().replace(/"/g, ''));
+    return lines.map(line => {
+        const values = line.split(',');
+        const row = {};
+        columns.forEach((c, i) => { row[c] = Number(values[i]); });
+        return row;
+    });
+}
+
+// Finest full-scale range that holds every sample, as the sensor would use
+function pickScale(rows) {
+    const peak = rows.reduce((m, r) => Math.max(m, Math.abs(r.x), Math.abs(r.y), Math.abs(r.z)), 0);
+    for (const rangeG of [2, 4, 8, 16]) {
+        if (peak < rangeG) {
+            return 32768 / rangeG;
+        }
+    }
+    return 32768 / 16;
+}
+
+function writeTrace(rows, outFile) {
+    if (rows.length === 0) {
+        console.error('No readings to export');
+        process.exit(1);
+    }
+
+    const rate = rows[0].sample_rate_hz;
+    if (rows.some(r => r.sample_rate_hz !== rate)) {
+        console.warn(`Readings mix sample rates; replaying all at ${rate} Hz`);
+    }
+
+    const scale = pickScale(rows);
+    const clamp = v => Math.max(-32768, Math.min(32767, Math.round(v * scale)));
+
+    const buf = Buffer.alloc(HEADER_SIZE + rows.length * 6);
+    buf.write('DSMT', 0, 'ascii');
+    buf.writeUInt16LE(TRACE_VERSION, 4);
+    buf.writeUInt16LE(rate, 6);
+    buf.writeFloatLE(scale, 8);
+    buf.writeUInt32LE(rows.length, 12);
+    rows.forEach((r, i) => {
+        const offset = HEADER_SIZE + i * 6;
+        buf.writeInt16LE(clamp(r.x), offset);
+        buf.writeInt16LE(clamp(r.y), offset + 2);
+        buf.writeInt16LE(clamp(r.z), offset + 4);
+    });
+
+    if (buf.length > TRACE_PARTITION_SIZE) {
+        console.warn(`Trace is ${buf.length} bytes; the trace partition holds ${TRACE_PARTITION_SIZE}`);
+    }
+
+    fs.writeFileSync(outFile, buf);
+    console.log(`Wrote ${rows.length} samples at ${rate} Hz (+-${32768 / scale} g) to ${outFile}`);
+}
+
+const args = process.argv.slice(2);
+if (args[0] === '--csv' && args.length === 3) {
+    writeTrace(readFromCsv(args[1]), args[2]);
+} else if (args.length >= 2 && args[0] !== '--csv') {
+    const first = args[2] !== undefined ? Number(args[2]) : 0;
+    const last = args[3] !== undefined ? Number(args[3]) : Number.MAX_SAFE_INTEGER;
+    writeTrace(readFromDatabase(args[0], first, last), args[1]);
+} else {
+    console.log('Usage: node export-trace.js <device_id> <out.trace> [first_batch] [last_batch]');
+    console.log('       node export-trace.js --csv <readings.csv> <out.trace>');
+    process.exit(1);
+}
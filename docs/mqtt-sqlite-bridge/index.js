@@ -10,9 +10,14 @@
  *   - driving/telemetry: Batched sensor readings (QoS 0)
  *
  * JSON Formats:
- *   Alerts:  {"type":"warning","event":"harsh_braking","ts":12345,"x":0.1,"y":-4.5}
- *   Crash:   {"type":"crash","ts":12345,"mag":8.5}
- *   Batch:   {"ts":12345,"rate":100,"n":500,"d":[[x,y,z],[x,y,z],...]}
+ *   Alerts:  {"type":"warning","event":"harsh_braking","ts":12345,"dur":620,"peak":-2.4,"x":0.1,"y":-2.4}
+ *   Crash:   {"type":"crash","ts":12345,"dur":40,"mag":8.5}
+ *            One alert per episode: dur is its length in ms, peak/mag the
+ *            furthest value past the threshold. Older firmware omits both.
+ *   Batch:   {"ts":12345,"rate":100,"n":500,"scale":4096.0,"d":[[x,y,z],[x,y,z],...]}
+ *            x, y, z are raw counts; g = count / scale. Without scale they are g.
+ *            Gyro firmware adds "gscale" and "temp" and sends [x,y,z,gx,gy,gz];
+ *            deg/s = count / gscale.
  */
 
 const mqtt = require('mqtt');
@@ -64,6 +69,7 @@ function initDatabase() {
             accel_magnitude REAL,         -- for crash events
             accel_x REAL,                 -- x acceleration (for warnings)
             accel_y REAL,                 -- y acceleration (for warnings)
+            duration_ms INTEGER,          -- episode length
             received_at INTEGER NOT NULL,
             created_at DATETIME DEFAULT CURRENT_TIMESTAMP
         );
@@ -79,6 +85,10 @@ function initDatabase() {
             x REAL NOT NULL,
             y REAL NOT NULL,
             z REAL NOT NULL,
+            gx REAL,                            -- deg/s, gyro firmware only
+            gy REAL,
+            gz REAL,
+            temperature_c REAL,                 -- per batch, gyro firmware only
             received_at INTEGER NOT NULL,
             created_at DATETIME DEFAULT CURRENT_TIMESTAMP
         );
@@ -91,27 +101,40 @@ function initDatabase() {
         CREATE INDEX IF NOT EXISTS idx_readings_created ON sensor_readings(created_at);
     `);
 
+    // Databases from before episode alerts and gyro telemetry lack these
+    const addMissing = (table, columns) => {
+        const existing = db.prepare(`PRAGMA table_info(${table})`).all();
+        for (const [name, type] of columns) {
+            if (!existing.some(c => c.name === name)) {
+                db.exec(`ALTER TABLE ${table} ADD COLUMN ${name} ${type}`);
+            }
+        }
+    };
+    addMissing('alerts', [['duration_ms', 'INTEGER']]);
+    addMissing('sensor_readings', [['gx', 'REAL'], ['gy', 'REAL'], ['gz', 'REAL'], ['temperature_c', 'REAL']]);
+
     // Get the max batch_id to continue from
     const maxBatch = db.prepare('SELECT MAX(batch_id) as max FROM sensor_readings').get();
     batchCounter = (maxBatch.max || 0) + 1;
 
     // Prepare insert statements
     db.insertAlert = db.prepare(`
-        INSERT INTO alerts (type, event, device_timestamp, accel_magnitude, accel_x, accel_y, received_at)
-        VALUES (?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO alerts (type, event, device_timestamp, accel_magnitude, accel_x, accel_y, duration_ms, received_at)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?)
     `);
 
     db.insertReading = db.prepare(`
-        INSERT INTO sensor_readings (batch_id, sample_index, batch_start_timestamp, sample_rate_hz, calculated_timestamp, x, y, z, received_at)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO sensor_readings (batch_id, sample_index, batch_start_timestamp, sample_rate_hz, calculated_timestamp, x, y, z, gx, gy, gz, temperature_c, received_at)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     `);
 
     // Batch insert for sensor readings (much faster)
-    db.insertReadingsBatch = db.transaction((batchId, batchStartTimestamp, sampleRateHz, samples, receivedAt) => {
+    db.insertReadingsBatch = db.transaction((batchId, batchStartTimestamp, sampleRateHz, samples, temperatureC, receivedAt) => {
         for (let i = 0; i < samples.length; i++) {
             const calculatedTimestamp = batchStartTimestamp + Math.floor(i * 1000 / sampleRateHz);
-            const [x, y, z] = samples[i];
-            db.insertReading.run(batchId, i, batchStartTimestamp, sampleRateHz, calculatedTimestamp, x, y, z, receivedAt);
+            const [x, y, z, gx = null, gy = null, gz = null] = samples[i];
+            db.insertReading.run(batchId, i, batchStartTimestamp, sampleRateHz, calculatedTimestamp,
+                x, y, z, gx, gy, gz, temperatureC, receivedAt);
         }
     });
 
@@ -123,8 +146,8 @@ function initDatabase() {
  * Handle alert message (driving/alerts topic)
  *
  * Expected JSON format:
- * Warning: {"type":"warning","event":"harsh_braking","ts":12345,"x":0.1,"y":-4.5}
- * Crash:   {"type":"crash","ts":12345,"mag":8.5}
+ * Warning: {"type":"warning","event":"harsh_braking","ts":12345,"dur":620,"peak":-2.4,"x":0.1,"y":-2.4}
+ * Crash:   {"type":"crash","ts":12345,"dur":40,"mag":8.5}
  */
 function handleAlert(message) {
     const data = JSON.parse(message.toString());
@@ -138,6 +161,7 @@ function handleAlert(message) {
             data.mag,
             null,
             null,
+            data.dur !== undefined ? data.dur : null,
             receivedAt
         );
         console.log(`[Alert] CRASH detected! magnitude=${data.mag} (id: ${result.lastInsertRowid})`);
@@ -146,9 +170,10 @@ function handleAlert(message) {
             'warning',
             data.event,
             data.ts,
-            null,
+            data.peak !== undefined ? data.peak : null,
             data.x,
             data.y,
+            data.dur !== undefined ? data.dur : null,
             receivedAt
         );
         console.log(`[Alert] WARNING: ${data.event} x=${data.x} y=${data.y} (id: ${result.lastInsertRowid})`);
@@ -161,15 +186,23 @@ function handleAlert(message) {
  * Handle telemetry batch (driving/telemetry topic)
  *
  * Expected JSON format:
- * {"ts":12345,"rate":100,"n":500,"d":[[x,y,z],[x,y,z],...]}
+ * {"ts":12345,"rate":100,"n":500,"scale":4096.0,"d":[[x,y,z],[x,y,z],...]}
+ * Gyro firmware: "gscale" and "temp" in the header, [x,y,z,gx,gy,gz] samples
  */
 function handleTelemetry(message) {
     const data = JSON.parse(message.toString());
     const receivedAt = Date.now();
     const batchId = batchCounter++;
+    const samples = data.scale
+        ? data.d.map(([x, y, z, ...gyro]) => [
+            x / data.scale, y / data.scale, z / data.scale,
+            ...(data.gscale ? gyro.map(g => g / data.gscale) : [])
+        ])
+        : data.d;
+    const temperatureC = data.temp !== undefined ? data.temp : null;
 
     // Insert all sensor readings in a transaction (fast)
-    db.insertReadingsBatch(batchId, data.ts, data.rate, data.d, receivedAt);
+    db.insertReadingsBatch(batchId, data.ts, data.rate, samples, temperatureC, receivedAt);
 
     console.log(`[Telemetry] Batch stored: ${data.n} samples (batch_id: ${batchId})`);
 }
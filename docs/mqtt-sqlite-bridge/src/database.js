@@ -18,6 +18,7 @@ function init() {
             accel_magnitude REAL,
             accel_x REAL,
             accel_y REAL,
+            duration_ms INTEGER,
             received_at INTEGER NOT NULL,
             created_at DATETIME DEFAULT CURRENT_TIMESTAMP
         );
@@ -33,6 +34,10 @@ function init() {
             x REAL NOT NULL,
             y REAL NOT NULL,
             z REAL NOT NULL,
+            gx REAL,
+            gy REAL,
+            gz REAL,
+            temperature_c REAL,
             received_at INTEGER NOT NULL,
             created_at DATETIME DEFAULT CURRENT_TIMESTAMP
         );
@@ -45,6 +50,20 @@ function init() {
         CREATE INDEX IF NOT EXISTS idx_readings_timestamp ON sensor_readings(calculated_timestamp);
     `);
 
+    // Databases created before episode alerts lack the duration column
+    const alertColumns = db.prepare('PRAGMA table_info(alerts)').all();
+    if (!alertColumns.some(c => c.name === 'duration_ms')) {
+        db.exec('ALTER TABLE alerts ADD COLUMN duration_ms INTEGER');
+    }
+
+    // ... and databases created before gyro telemetry lack these
+    const readingColumns = db.prepare('PRAGMA table_info(sensor_readings)').all();
+    for (const column of ['gx', 'gy', 'gz', 'temperature_c']) {
+        if (!readingColumns.some(c => c.name === column)) {
+            db.exec(`ALTER TABLE sensor_readings ADD COLUMN ${column} REAL`);
+        }
+    }
+
     const maxBatch = db.prepare('SELECT MAX(batch_id) as max FROM sensor_readings').get();
     batchCounter = (maxBatch.max || 0) + 1;
 
@@ -60,12 +79,12 @@ function getNextBatchId() {
 }
 
 // Alert operations
-function insertAlert(deviceId, type, event, timestamp, magnitude, accelX, accelY) {
+function insertAlert(deviceId, type, event, timestamp, magnitude, accelX, accelY, durationMs = null) {
     const receivedAt = Date.now();
     db.prepare(`
-        INSERT INTO alerts (device_id, type, event, device_timestamp, accel_magnitude, accel_x, accel_y, received_at)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?)
-    `).run(deviceId, type, event, timestamp, magnitude, accelX, accelY, receivedAt);
+        INSERT INTO alerts (device_id, type, event, device_timestamp, accel_magnitude, accel_x, accel_y, duration_ms, received_at)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)
+    `).run(deviceId, type, event, timestamp, magnitude, accelX, accelY, durationMs, receivedAt);
 }
 
 function getAlerts(deviceId, limit = 50) {
@@ -125,19 +144,21 @@ function deleteAlerts(deviceId) {
     }
 }
 
-// Sensor reading operations
-function insertReadingsBatch(deviceId, batchId, batchStartTimestamp, sampleRateHz, samples) {
+// Sensor reading operations. Samples are [x, y, z] in g, followed by
+// [gx, gy, gz] in deg/s on gyro firmware.
+function insertReadingsBatch(deviceId, batchId, batchStartTimestamp, sampleRateHz, samples, temperatureC = null) {
     const receivedAt = Date.now();
     const insertReading = db.prepare(`
-        INSERT INTO sensor_readings (device_id, batch_id, sample_index, batch_start_timestamp, sample_rate_hz, calculated_timestamp, x, y, z, received_at)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO sensor_readings (device_id, batch_id, sample_index, batch_start_timestamp, sample_rate_hz, calculated_timestamp, x, y, z, gx, gy, gz, temperature_c, received_at)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     `);
 
     const transaction = db.transaction(() => {
         for (let i = 0; i < samples.length; i++) {
             const calculatedTimestamp = batchStartTimestamp + Math.floor(i * 1000 / sampleRateHz);
-            const [x, y, z] = samples[i];
-            insertReading.run(deviceId, batchId, i, batchStartTimestamp, sampleRateHz, calculatedTimestamp, x, y, z, receivedAt);
+            const [x, y, z, gx = null, gy = null, gz = null] = samples[i];
+            insertReading.run(deviceId, batchId, i, batchStartTimestamp, sampleRateHz, calculatedTimestamp,
+                x, y, z, gx, gy, gz, temperatureC, receivedAt);
         }
     });
 
@@ -53,20 +53,36 @@ function handleAlert(data) {
     devices.getOrCreate(deviceId);
 
     if (data.type === 'crash') {
-        db.insertAlert(deviceId, 'crash', null, data.ts, data.mag, null, null);
+        db.insertAlert(deviceId, 'crash', null, data.ts, data.mag, null, null, data.dur);
         console.log(`[Alert] ${deviceId}: CRASH magnitude=${data.mag}`);
     } else if (data.type === 'warning') {
-        db.insertAlert(deviceId, 'warning', data.event, data.ts, null, data.x, data.y);
+        // Older firmware sends one warning per sample, with no peak or duration
+        const peak = data.peak !== undefined ? data.peak : null;
+        db.insertAlert(deviceId, 'warning', data.event, data.ts, peak, data.x, data.y, data.dur);
         console.log(`[Alert] ${deviceId}: WARNING ${data.event}`);
     }
 }
 
+// Newer firmware sends raw sensor counts with the LSB-per-g scale in the
+// header; older firmware sends g directly and no scale. Gyro firmware adds
+// gx, gy, gz counts to each sample, with their LSB-per-deg/s in gscale.
+function samplesInUnits(data) {
+    if (!data.scale) {
+        return data.d;
+    }
+    return data.d.map(([x, y, z, ...gyro]) => [
+        x / data.scale, y / data.scale, z / data.scale,
+        ...(data.gscale ? gyro.map(g => g / data.gscale) : [])
+    ]);
+}
+
 function handleTelemetry(data) {
     const deviceId = data.dev || 'unknown';
     const batchId = db.getNextBatchId();
 
     devices.getOrCreate(deviceId);
-    db.insertReadingsBatch(deviceId, batchId, data.ts, data.rate, data.d);
+    db.insertReadingsBatch(deviceId, batchId, data.ts, data.rate, samplesInUnits(data),
+        data.temp !== undefined ? data.temp : null);
     console.log(`[Telemetry] ${deviceId}: ${data.n} samples (batch_id: ${batchId})`);
 }
 
@@ -0,0 +1,79 @@
+// Time per sample through the detector input filter at every order, per
+// reading and, in float builds, per block. Built once per number format.
+
+#include "processing/biquad.h"
+#include "config.h"
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_SAMPLES 20000000
+#define BLOCK_SAMPLES 32 // DETECTOR_BLOCK_SIZE
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *label, int stages, double s)
+{
+    printf("%-12s order %d  %6.2f ns  (per sample)\n", label, 2 * stages,
+           s * 1e9 / BENCH_SAMPLES);
+}
+
+static void bench_reading(int stages)
+{
+    static biquad_cascade_t f;
+    biquad_design_lowpass(&f, stages, 50.0f, 1000.0f);
+    const accel_t up = accel_from_g(0.2f), down = accel_from_g(-0.2f);
+    sensor_reading_t r = {.x = accel_from_g(0.1f), .y = down, .z = ACCEL_ONE_G};
+    volatile float sink = 0.0f;
+
+    double start = now_s();
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        r.y = (i & 1) ? down : up;
+        biquad_process(&f, &r);
+    }
+    sink += accel_to_g(r.x);
+    report("per reading", stages, now_s() - start);
+}
+
+#if !DETECTOR_FIXED_POINT
+static void bench_block(int stages)
+{
+    static biquad_cascade_t f;
+    static float x[BLOCK_SAMPLES], y[BLOCK_SAMPLES], z[BLOCK_SAMPLES];
+    float *const axis[BIQUAD_AXES] = {x, y, z};
+    biquad_design_lowpass(&f, stages, 50.0f, 1000.0f);
+    volatile float sink = 0.0f;
+
+    double start = now_s();
+    for (int round = 0; round < BENCH_SAMPLES / BLOCK_SAMPLES; round++)
+    {
+        for (int i = 0; i < BLOCK_SAMPLES; i++)
+        {
+            x[i] = 0.1f;
+            y[i] = (i & 1) ? -0.2f : 0.2f;
+            z[i] = 1.0f;
+        }
+        biquad_process_block(&f, axis, BLOCK_SAMPLES);
+    }
+    sink += x[0];
+    report("per block", stages, now_s() - start);
+}
+#endif
+
+int main(void)
+{
+    printf("%s biquad cascade, 3 axes\n", DETECTOR_FIXED_POINT ? "Q10 fixed-point" : "float");
+    for (int stages = 1; stages <= BIQUAD_MAX_STAGES; stages++)
+    {
+        bench_reading(stages);
+#if !DETECTOR_FIXED_POINT
+        bench_block(stages);
+#endif
+    }
+    return 0;
+}
@@ -0,0 +1,212 @@
+// Checks the detector input filter at every order it can be set to: unity DC
+// gain, -3 dB at the cutoff and the Butterworth roll-off past it, that it
+// primes to its first sample, and that it tracks a double-precision cascade
+// of the same design sample by sample. Built once for each reading type,
+// float and Q10; the float build also checks block filtering against
+// per-reading filtering.
+
+#include "processing/biquad.h"
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TONE_G 8.0f           // Large, so Q10 rounding stays out of the gains
+#define DC_TOLERANCE_DB 0.05f
+#define CUTOFF_TOLERANCE_DB 0.1f
+#define ROLLOFF_MARGIN_DB 1.0f // Below 6.02 dB per order at twice the cutoff
+#define TRACK_SAMPLES 4000
+// Single-precision poles at a cutoff far below the rate cost about half a
+// mg against the double design; Q10 rounding adds a step on top
+#define TRACK_TOLERANCE_G 2e-3f
+
+typedef struct {
+    float cutoff_hz;
+    float sample_rate_hz;
+} design_t;
+
+static const design_t designs[] = {{10, 100}, {20, 100}, {5, 1000}, {50, 1000}};
+
+// The same design in double, direct form II transposed
+typedef struct {
+    int stages;
+    double b0[BIQUAD_MAX_STAGES], b1[BIQUAD_MAX_STAGES], b2[BIQUAD_MAX_STAGES];
+    double a1[BIQUAD_MAX_STAGES], a2[BIQUAD_MAX_STAGES];
+    double s[BIQUAD_MAX_STAGES][2];
+    bool primed;
+} reference_t;
+
+static void reference_design(reference_t *ref, int stages, double cutoff_hz, double rate_hz)
+{
+    ref->stages = stages;
+    ref->primed = false;
+    double w0 = 2 * M_PI * cutoff_hz / rate_hz;
+    for (int k = 0; k < stages; k++)
+    {
+        double q = 1 / (2 * cos(M_PI * (2 * k + 1) / (4.0 * stages)));
+        double alpha = sin(w0) / (2 * q);
+        double a0 = 1 + alpha;
+        ref->b1[k] = (1 - cos(w0)) / a0;
+        ref->b0[k] = ref->b2[k] = ref->b1[k] / 2;
+        ref->a1[k] = -2 * cos(w0) / a0;
+        ref->a2[k] = (1 - alpha) / a0;
+    }
+}
+
+static double reference_process(reference_t *ref, double x)
+{
+    for (int k = 0; k < ref->stages; k++)
+    {
+        if (!ref->primed)
+        {
+            // Unity DC gain: settled on x, every section outputs x
+            ref->s[k][1] = ref->b2[k] * x - ref->a2[k] * x;
+            ref->s[k][0] = ref->b1[k] * x - ref->a1[k] * x + ref->s[k][1];
+        }
+        double y = ref->b0[k] * x + ref->s[k][0];
+        ref->s[k][0] = ref->b1[k] * x - ref->a1[k] * y + ref->s[k][1];
+        ref->s[k][1] = ref->b2[k] * x - ref->a2[k] * y;
+        x = y;
+    }
+    ref->primed = true;
+    return x;
+}
+
+// A complex tone on x/y comes out as one of constant magnitude once settled
+static float gain_db(int stages, const design_t *d, float hz)
+{
+    static biquad_cascade_t f;
+    biquad_design_lowpass(&f, stages, d->cutoff_hz, d->sample_rate_hz);
+    float w = 2.0f * (float)M_PI * hz / d->sample_rate_hz;
+    int settle = (int)(20.0f * d->sample_rate_hz / d->cutoff_hz);
+    sensor_reading_t r = {0};
+    for (int n = 0; n < settle; n++)
+    {
+        r = (sensor_reading_t){
+            .x = accel_from_g(TONE_G * cosf(w * n)),
+            .y = accel_from_g(TONE_G * sinf(w * n)),
+            .z = ACCEL_ONE_G,
+        };
+        biquad_process(&f, &r);
+    }
+    return 20.0f * log10f(hypotf(accel_to_g(r.x), accel_to_g(r.y)) / TONE_G);
+}
+
+// Steps, a tone and noise, on all three axes
+static float test_signal(int n, int axis)
+{
+    float step = (n / 500) % 2 ? 3.0f : -1.5f;
+    float tone = 2.0f * sinf(0.07f * n * (axis + 1));
+    float noise = (float)rand() / RAND_MAX - 0.5f;
+    return (axis == 2 ? 1.0f : 0.0f) + step + tone + noise;
+}
+
+static float track_error(int stages, const design_t *d)
+{
+    static biquad_cascade_t f;
+    reference_t ref[3];
+    biquad_design_lowpass(&f, stages, d->cutoff_hz, d->sample_rate_hz);
+    for (int a = 0; a < 3; a++)
+        reference_design(&ref[a], stages, d->cutoff_hz, d->sample_rate_hz);
+
+    float worst = 0.0f;
+    srand(1);
+    for (int n = 0; n < TRACK_SAMPLES; n++)
+    {
+        sensor_reading_t r = {
+            .x = accel_from_g(test_signal(n, 0)),
+            .y = accel_from_g(test_signal(n, 1)),
+            .z = accel_from_g(test_signal(n, 2)),
+        };
+        // The reference sees what the filter sees, quantized in fixed builds
+        double in[3] = {accel_to_g(r.x), accel_to_g(r.y), accel_to_g(r.z)};
+        biquad_process(&f, &r);
+        float out[3] = {accel_to_g(r.x), accel_to_g(r.y), accel_to_g(r.z)};
+        for (int a = 0; a < 3; a++)
+            worst = fmaxf(worst, (float)fabs(out[a] - reference_process(&ref[a], in[a])));
+    }
+    return worst;
+}
+
+// The first reading comes out unchanged, so z starts at 1 g
+static bool primes(int stages, const design_t *d)
+{
+    static biquad_cascade_t f;
+    biquad_design_lowpass(&f, stages, d->cutoff_hz, d->sample_rate_hz);
+    sensor_reading_t in = {.x = accel_from_g(0.3f), .y = accel_from_g(-0.2f), .z = ACCEL_ONE_G};
+    sensor_reading_t out = in;
+    biquad_process(&f, &out);
+    float tolerance = DETECTOR_FIXED_POINT ? 0.0f : 1e-5f;
+    return fabsf(accel_to_g(out.x) - accel_to_g(in.x)) <= tolerance &&
+           fabsf(accel_to_g(out.y) - accel_to_g(in.y)) <= tolerance &&
+           fabsf(accel_to_g(out.z) - accel_to_g(in.z)) <= tolerance;
+}
+
+#if !DETECTOR_FIXED_POINT
+#define BLOCK_SAMPLES 32
+
+// Block filtering runs the same arithmetic in a different order
+static float block_error(int stages, const design_t *d)
+{
+    static biquad_cascade_t per_reading, block;
+    biquad_design_lowpass(&per_reading, stages, d->cutoff_hz, d->sample_rate_hz);
+    biquad_design_lowpass(&block, stages, d->cutoff_hz, d->sample_rate_hz);
+
+    float worst = 0.0f;
+    srand(1);
+    for (int b = 0; b < TRACK_SAMPLES / BLOCK_SAMPLES; b++)
+    {
+        float x[BLOCK_SAMPLES], y[BLOCK_SAMPLES], z[BLOCK_SAMPLES];
+        float *const axis[BIQUAD_AXES] = {x, y, z};
+        sensor_reading_t r[BLOCK_SAMPLES];
+        for (int i = 0; i < BLOCK_SAMPLES; i++)
+        {
+            int n = b * BLOCK_SAMPLES + i;
+            r[i] = (sensor_reading_t){.x = x[i] = test_signal(n, 0),
+                                      .y = y[i] = test_signal(n, 1),
+                                      .z = z[i] = test_signal(n, 2)};
+            biquad_process(&per_reading, &r[i]);
+        }
+        biquad_process_block(&block, axis, BLOCK_SAMPLES);
+        for (int i = 0; i < BLOCK_SAMPLES; i++)
+        {
+            worst = fmaxf(worst, fabsf(x[i] - r[i].x));
+            worst = fmaxf(worst, fabsf(y[i] - r[i].y));
+            worst = fmaxf(worst, fabsf(z[i] - r[i].z));
+        }
+    }
+    return worst;
+}
+#endif
+
+int main(void)
+{
+    int failures = 0;
+    printf("%s readings\n", DETECTOR_FIXED_POINT ? "Q10 fixed-point" : "float");
+    printf("order  cutoff  rate  DC dB  cutoff dB  2x cutoff dB  track err g\n");
+    for (size_t i = 0; i < sizeof(designs) / sizeof(designs[0]); i++)
+    {
+        const design_t *d = &designs[i];
+        for (int stages = 1; stages <= BIQUAD_MAX_STAGES; stages++)
+        {
+            float dc = gain_db(stages, d, 0.0f);
+            float at_cutoff = gain_db(stages, d, d->cutoff_hz);
+            float at_double = gain_db(stages, d, 2.0f * d->cutoff_hz);
+            float rolloff = 6.02f * 2 * stages - ROLLOFF_MARGIN_DB;
+            float track = track_error(stages, d);
+
+            bool ok = fabsf(dc) <= DC_TOLERANCE_DB &&
+                      fabsf(at_cutoff + 3.01f) <= CUTOFF_TOLERANCE_DB && at_double <= -rolloff &&
+                      track <= TRACK_TOLERANCE_G && primes(stages, d);
+#if !DETECTOR_FIXED_POINT
+            ok = ok && block_error(stages, d) <= 1e-5f;
+#endif
+            printf("%5d  %6.0f  %4.0f  %+5.2f  %9.2f  %12.1f  %11.5f  %s\n", 2 * stages,
+                   d->cutoff_hz, d->sample_rate_hz, dc, at_cutoff, at_double, track,
+                   ok ? "ok" : "FAIL");
+            if (!ok)
+                failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
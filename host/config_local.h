@@ -0,0 +1,9 @@
+#ifndef CONFIG_LOCAL_H
+#define CONFIG_LOCAL_H
+
+// Host builds never reach WiFi; config.h just needs the names defined
+
+#define WIFI_SSID ""
+#define WIFI_PASSWORD ""
+
+#endif // CONFIG_LOCAL_H
@@ -0,0 +1,68 @@
+// Measures the decimator's magnitude response at every factor the sensor can
+// pick and checks it against what the FIR is designed for: flat to 0.2 dB
+// through 0.2x the output rate and at least 60 dB down from the output Nyquist
+// frequency to the raw one. Built once for each reading type, float and Q10.
+
+#include "processing/decimator.h"
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+
+#define PASSBAND_EDGE 0.2f      // Of the output rate
+#define PASSBAND_RIPPLE_DB 0.2f
+#define STOPBAND_MIN_DB 60.0f
+#define SWEEP_STEPS 200
+#define TONE_G 16.0f // Large, so Q10 rounding in fixed builds stays under -60 dB
+
+// A complex tone on x/y comes out as one of the same magnitude, aliased or
+// not, so a single settled output gives the gain at that frequency
+static float gain_db(uint8_t factor, float hz)
+{
+    decimator_configure(factor);
+    float w = 2.0f * (float)M_PI * hz / IMU_RAW_RATE_MAX_HZ;
+    uint32_t settle = 4u * DECIMATOR_TAPS_PER_PHASE * factor;
+    sensor_reading_t out = {0};
+    for (uint32_t n = 0; n < settle; n++)
+    {
+        sensor_reading_t in = {
+            .x = accel_from_g(TONE_G * cosf(w * n)),
+            .y = accel_from_g(TONE_G * sinf(w * n)),
+            .timestamp_us = n * 1000,
+        };
+        decimator_push(&in, &out);
+    }
+    return 20.0f * log10f(hypotf(accel_to_g(out.x), accel_to_g(out.y)) / TONE_G + 1e-12f);
+}
+
+int main(void)
+{
+    int failures = 0;
+    printf("factor  out Hz  passband dB (min/max)  stopband dB (worst)\n");
+    for (uint8_t factor = 2; factor <= IMU_OVERSAMPLE_MAX; factor++)
+    {
+        if (IMU_RAW_RATE_MAX_HZ % factor != 0)
+            continue;
+        float out_hz = (float)IMU_RAW_RATE_MAX_HZ / factor;
+
+        float pass_min = 0.0f, pass_max = -1e9f;
+        for (int i = 0; i <= SWEEP_STEPS; i++)
+        {
+            float g = gain_db(factor, PASSBAND_EDGE * out_hz * i / SWEEP_STEPS);
+            pass_min = fminf(pass_min, g);
+            pass_max = fmaxf(pass_max, g);
+        }
+
+        float stop_worst = -1e9f;
+        float stop_lo = out_hz / 2.0f, stop_hi = IMU_RAW_RATE_MAX_HZ / 2.0f;
+        for (int i = 0; i <= SWEEP_STEPS; i++)
+            stop_worst = fmaxf(stop_worst, gain_db(factor, stop_lo + (stop_hi - stop_lo) * i / SWEEP_STEPS));
+
+        bool ok = pass_min >= -PASSBAND_RIPPLE_DB && pass_max <= PASSBAND_RIPPLE_DB &&
+                  stop_worst <= -STOPBAND_MIN_DB;
+        printf("%6u  %6.1f  %+8.3f / %+7.3f  %18.1f  %s\n", factor, out_hz, pass_min, pass_max,
+               stop_worst, ok ? "ok" : "FAIL");
+        if (!ok)
+            failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+// Samples/s through the fused detector evaluation pass, per stream, on a
+// quiet block (the path almost every block takes) and on one crossing
+// thresholds throughout. Built once per number format.
+
+#include "processing/detector_kernels.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_BLOCKS 2000000
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void default_thresholds(detector_thresholds_t *th)
+{
+#define X(id, name, kind, signal, ...)                                                       \
+    th->enter[DETECTOR_##id] = severity_from_g(DEFAULT_##id##_THRESHOLD_G,                  \
+                                               SIGNAL_SQUARED_##signal);                    \
+    th->exit[DETECTOR_##id] = severity_from_g(DEFAULT_##id##_THRESHOLD_G * DETECTOR_EXIT_RATIO, \
+                                              SIGNAL_SQUARED_##signal);
+    DETECTOR_LIST(X)
+#undef X
+}
+
+static void fill_block(sensor_block_t *block, float spread_g)
+{
+    for (int i = 0; i < DETECTOR_BLOCK_SIZE; i++)
+    {
+        float r = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+        sensor_reading_t reading = {
+            .x = accel_from_g(spread_g * r),
+            .y = accel_from_g(-spread_g * r),
+            .z = accel_from_g(1.0f + spread_g * r / 2),
+            .timestamp_us = i * 10000,
+        };
+        sensor_block_append(block, &reading);
+    }
+}
+
+static void run(const char *label, const sensor_block_t *block, detector_stream_t stream,
+                const detector_thresholds_t *thresholds)
+{
+    static detector_block_result_t result;
+    volatile uint32_t sink = 0;
+
+    double start = now_s();
+    for (int round = 0; round < BENCH_BLOCKS; round++)
+    {
+        detector_evaluate_block(block, stream, thresholds, &result);
+        sink |= result.entered[0];
+    }
+    double s = now_s() - start;
+
+    double samples = (double)BENCH_BLOCKS * DETECTOR_BLOCK_SIZE;
+    printf("%-24s %6.2f ns  %8.1f Msamples/s  (per sample)\n", label, s * 1e9 / samples,
+           samples / s / 1e6);
+}
+
+int main(void)
+{
+    static sensor_block_t quiet, busy;
+    detector_thresholds_t thresholds;
+    default_thresholds(&thresholds);
+    srand(1);
+    fill_block(&quiet, 0.1f);
+    fill_block(&busy, 4.0f);
+
+    printf("%s detectors\n", DETECTOR_FIXED_POINT ? "Q10 fixed-point" : "float");
+    run("full, quiet", &quiet, DETECTOR_STREAM_FULL, &thresholds);
+    run("full, crossing", &busy, DETECTOR_STREAM_FULL, &thresholds);
+    run("decimated, quiet", &quiet, DETECTOR_STREAM_DECIMATED, &thresholds);
+    run("decimated, crossing", &busy, DETECTOR_STREAM_DECIMATED, &thresholds);
+    return 0;
+}
@@ -0,0 +1,131 @@
+// Runs the float and the Q10 detector kernels on the same readings and checks
+// they pick exactly the same samples. The readings are int16 counts at the
+// +-16 g range, even ones only: the Q10 grid, which both formats hold
+// exactly. Thresholds are on that grid too, and every magnitude stays under
+// 4 g so its square in g^2 is exact in a float. Half the samples sit within a
+// count of a threshold, the rest are spread over +-2.25 g.
+
+#include "processing/detector.h"
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LSB_PER_G 2048 // +-16 g range; Q10 is every other count
+#define BLOCK 32
+#define BLOCKS 20000
+#define SPREAD_Q 2300  // Per axis; 3 * 2300^2 stays under 2^24
+#define QUIET_Q 300    // Axes a boundary sample does not test
+
+typedef void evaluate_fn(const int16_t (*counts)[3], size_t n, int32_t lsb_per_g,
+                         const int16_t *enter_q, const int16_t *exit_q, uint32_t *entered,
+                         uint32_t *stayed);
+evaluate_fn evaluate_float, evaluate_fixed;
+
+static int32_t random_q(int32_t range)
+{
+    return rand() % (2 * range + 1) - range;
+}
+
+// Q10 values for x, y and dynamic z with the signal at v. Magnitude puts v on
+// one axis half the time, to hit the threshold exactly, and otherwise spreads
+// it over all three to within a count.
+static void boundary_MAGNITUDE(int32_t v, int32_t q[3])
+{
+    if (rand() % 2)
+    {
+        q[0] = q[1] = q[2] = 0;
+        q[rand() % 3] = rand() % 2 ? v : -v;
+        return;
+    }
+    q[0] = random_q(v / 2);
+    q[1] = random_q(v / 2);
+    q[2] = (int32_t)lrint(sqrt((double)v * v - q[0] * q[0] - q[1] * q[1]));
+    if (rand() % 2)
+        q[2] = -q[2];
+}
+
+static void boundary_BRAKING(int32_t v, int32_t q[3])
+{
+    q[0] = random_q(QUIET_Q);
+    q[1] = -v;
+    q[2] = random_q(QUIET_Q);
+}
+
+static void boundary_ACCEL(int32_t v, int32_t q[3])
+{
+    q[0] = random_q(QUIET_Q);
+    q[1] = v;
+    q[2] = random_q(QUIET_Q);
+}
+
+static void boundary_LATERAL(int32_t v, int32_t q[3])
+{
+    q[0] = rand() % 2 ? v : -v;
+    q[1] = random_q(QUIET_Q);
+    q[2] = random_q(QUIET_Q);
+}
+
+static void (*const boundary[DETECTOR_COUNT])(int32_t v, int32_t q[3]) = {
+#define X(id, name, kind, signal, ...) boundary_##signal,
+    DETECTOR_LIST(X)
+#undef X
+};
+
+static const char *const names[DETECTOR_COUNT] = {
+#define X(id, name, ...) name,
+    DETECTOR_LIST(X)
+#undef X
+};
+
+int main(void)
+{
+    int16_t enter_q[DETECTOR_COUNT], exit_q[DETECTOR_COUNT];
+    int d = 0;
+#define X(id, ...)                                                               \
+    enter_q[d] = (int16_t)lrintf(DEFAULT_##id##_THRESHOLD_G * 1024);             \
+    exit_q[d] = (int16_t)lrintf(DEFAULT_##id##_THRESHOLD_G * DETECTOR_EXIT_RATIO * 1024); \
+    d++;
+    DETECTOR_LIST(X)
+#undef X
+
+    static int16_t counts[BLOCK][3];
+    unsigned long mismatches[DETECTOR_COUNT] = {0}, hits[DETECTOR_COUNT] = {0};
+    srand(1);
+    for (int b = 0; b < BLOCKS; b++)
+    {
+        for (int i = 0; i < BLOCK; i++)
+        {
+            int32_t q[3] = {random_q(SPREAD_Q), random_q(SPREAD_Q), random_q(SPREAD_Q)};
+            if (rand() % 2)
+            {
+                d = rand() % DETECTOR_COUNT;
+                int32_t t = rand() % 2 ? enter_q[d] : exit_q[d];
+                boundary[d](t + rand() % 3 - 1, q);
+            }
+            for (int a = 0; a < 3; a++)
+                counts[i][a] = (int16_t)((q[a] + (a == 2 ? 1024 : 0)) * (LSB_PER_G / 1024));
+        }
+
+        uint32_t entered_f[DETECTOR_COUNT], stayed_f[DETECTOR_COUNT];
+        uint32_t entered_q[DETECTOR_COUNT], stayed_q[DETECTOR_COUNT];
+        evaluate_float(counts, BLOCK, LSB_PER_G, enter_q, exit_q, entered_f, stayed_f);
+        evaluate_fixed(counts, BLOCK, LSB_PER_G, enter_q, exit_q, entered_q, stayed_q);
+        for (d = 0; d < DETECTOR_COUNT; d++)
+        {
+            uint32_t diff = (entered_f[d] ^ entered_q[d]) | (stayed_f[d] ^ stayed_q[d]);
+            mismatches[d] += __builtin_popcount(diff);
+            hits[d] += __builtin_popcount(stayed_f[d]);
+        }
+    }
+
+    int failures = 0;
+    for (d = 0; d < DETECTOR_COUNT; d++)
+    {
+        printf("%-16s %8lu samples past exit, %lu differ  %s\n", names[d], hits[d], mismatches[d],
+               mismatches[d] ? "FAIL" : "ok");
+        if (mismatches[d])
+            failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
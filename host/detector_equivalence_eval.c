@@ -0,0 +1,47 @@
+// One side of detector_equivalence: the kernels' masks for a run of readings.
+// Built twice, with and without DETECTOR_FIXED_POINT, EVALUATE naming each
+// copy; the fixed build also renames the kernel functions it links against.
+
+#include "processing/detector_kernels.h"
+#include "config.h"
+#include <string.h>
+
+void EVALUATE(const int16_t (*counts)[3], size_t n, int32_t lsb_per_g, const int16_t *enter_q,
+              const int16_t *exit_q, uint32_t *entered, uint32_t *stayed)
+{
+    detector_thresholds_t th;
+    int d = 0;
+#define X(id, name, kind, signal, ...)                                                 \
+    th.enter[d] = severity_from_g(enter_q[d] / 1024.0f, SIGNAL_SQUARED_##signal);      \
+    th.exit[d] = severity_from_g(exit_q[d] / 1024.0f, SIGNAL_SQUARED_##signal);        \
+    d++;
+    DETECTOR_LIST(X)
+#undef X
+
+    static sensor_block_t block;
+    static detector_block_result_t result;
+    block.count = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        sensor_reading_t r = {
+            .x = accel_from_counts(counts[i][0], lsb_per_g),
+            .y = accel_from_counts(counts[i][1], lsb_per_g),
+            .z = accel_from_counts(counts[i][2], lsb_per_g),
+            .timestamp_us = i * 1000,
+        };
+        sensor_block_append(&block, &r);
+    }
+
+    // Each detector runs on one stream, so the other leaves its masks empty
+    memset(entered, 0, DETECTOR_COUNT * sizeof(*entered));
+    memset(stayed, 0, DETECTOR_COUNT * sizeof(*stayed));
+    for (int stream = DETECTOR_STREAM_FULL; stream <= DETECTOR_STREAM_DECIMATED; stream++)
+    {
+        detector_evaluate_block(&block, (detector_stream_t)stream, &th, &result);
+        for (d = 0; d < DETECTOR_COUNT; d++)
+        {
+            entered[d] |= result.entered[d];
+            stayed[d] |= result.stayed[d];
+        }
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+// Host stand-in for the ESP-IDF error codes the harnesses' sources return
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_INVALID_VERSION 0x10A
+
+static inline const char *esp_err_to_name(esp_err_t err)
+{
+    return err == ESP_OK ? "ESP_OK" : "error";
+}
+
+#endif // ESP_ERR_H
@@ -0,0 +1,14 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+// Host stand-in for ESP-IDF logging: errors and warnings to stderr, the
+// rest dropped so harness output stays readable
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGD(tag, fmt, ...) ((void)(tag))
+
+#endif // ESP_LOG_H
@@ -0,0 +1,48 @@
+#ifndef ESP_PARTITION_H
+#define ESP_PARTITION_H
+
+// Host stand-in: there is no flash, so no partition is ever found. Harnesses
+// load traces from files with replay_open() instead of replay_init().
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { ESP_PARTITION_TYPE_DATA = 1 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+typedef enum { ESP_PARTITION_MMAP_DATA } esp_partition_mmap_memory_t;
+typedef uint32_t esp_partition_mmap_handle_t;
+
+typedef struct {
+    size_t size;
+} esp_partition_t;
+
+static inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                             esp_partition_subtype_t subtype,
+                                                             const char *label)
+{
+    (void)type;
+    (void)subtype;
+    (void)label;
+    return NULL;
+}
+
+static inline esp_err_t esp_partition_mmap(const esp_partition_t *part, size_t offset,
+                                           size_t size, esp_partition_mmap_memory_t memory,
+                                           const void **out, esp_partition_mmap_handle_t *handle)
+{
+    (void)part;
+    (void)offset;
+    (void)size;
+    (void)memory;
+    (void)out;
+    (void)handle;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    (void)handle;
+}
+
+#endif // ESP_PARTITION_H
@@ -0,0 +1,18 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+// Host stand-in: just the types and constants the queue, display and
+// detector headers name. Nothing on the host runs tasks.
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef struct {
+    void *unused;
+} StaticSemaphore_t;
+
+#define configTICK_RATE_HZ 100 // ESP-IDF's default
+
+#endif // FREERTOS_H
@@ -0,0 +1,6 @@
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include "freertos/FreeRTOS.h" // Host stand-in; see there
+
+#endif // SEMAPHORE_H
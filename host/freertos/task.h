@@ -0,0 +1,6 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "freertos/FreeRTOS.h" // Host stand-in; see there
+
+#endif // TASK_H
@@ -0,0 +1,167 @@
+// Plays a recorded drive (docs/mqtt-sqlite-bridge/export-trace.js) through
+// the detector path as the processing task runs it under REPLAY_SENSOR_DATA:
+// each stream's input filter, blocks, the fused evaluation pass and the
+// episode state machine. Prints the time per sample and the alerts the
+// drive raises. Replay never oversamples, so both streams see every reading.
+// Built once per number format.
+//
+//   replay_bench <file.trace> [passes]
+
+#include "processing/biquad.h"
+#include "processing/detector.h"
+#include "processing/detector_kernels.h"
+#include "queue/priority_queue.h"
+#include "sensor/replay.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    detector_stream_t stream;
+    biquad_cascade_t filter;
+    sensor_block_t block;
+} detector_input_t;
+
+static detector_input_t full_input = {.stream = DETECTOR_STREAM_FULL};
+static detector_input_t decimated_input = {.stream = DETECTOR_STREAM_DECIMATED};
+
+// Stand-ins for the queue and display the detectors report to: count instead
+priority_queue_t *mqtt_rb = NULL;
+static unsigned long alerts[DETECTOR_COUNT];
+static unsigned long confirmations;
+
+bool priority_queue_push(priority_queue_t *pq, size_t lane, const void *item, bool *dropped)
+{
+    (void)pq;
+    (void)lane;
+    const mqtt_message_t *msg = item;
+    const char *name = msg->type == MSG_CRASH ? detector_get_name(DETECTOR_CRASH)
+                                              : warning_event_to_string(msg->data.warning.event);
+    for (int d = 0; d < DETECTOR_COUNT; d++)
+    {
+        if (strcmp(name, detector_get_name(d)) == 0)
+            alerts[d]++;
+    }
+    if (dropped)
+        *dropped = false;
+    return true;
+}
+
+void triggerWarningCountdown(const char *message)
+{
+    (void)message;
+    confirmations++;
+}
+
+void triggerNormalWarning(const char *message)
+{
+    (void)message;
+    confirmations++;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *load(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    rewind(f);
+    void *data = length > 0 ? malloc(length) : NULL;
+    if (data && fread(data, 1, length, f) != (size_t)length)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = length > 0 ? (size_t)length : 0;
+    return data;
+}
+
+// As process.c: per-reading filtering as readings go into the block, block
+// filtering on the whole block as it is flushed
+static void flush_block(detector_input_t *input)
+{
+    sensor_block_t *block = &input->block;
+    if (block->count == 0)
+        return;
+#if DETECTOR_FILTER_BLOCK
+    biquad_process_block(&input->filter, (float *const[]){block->x, block->y, block->z},
+                         block->count);
+#endif
+    detectors_check_block(block, input->stream);
+    block->count = 0;
+}
+
+static void add_reading(detector_input_t *input, const sensor_reading_t *r)
+{
+#if DETECTOR_FILTER_BLOCK
+    bool full = sensor_block_append(&input->block, r);
+#else
+    sensor_reading_t filtered = *r;
+    biquad_process(&input->filter, &filtered);
+    bool full = sensor_block_append(&input->block, &filtered);
+#endif
+    if (full)
+        flush_block(input);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <file.trace> [passes]\n", argv[0]);
+        return 2;
+    }
+    int passes = argc > 2 ? atoi(argv[2]) : 1;
+    size_t size;
+    void *data = load(argv[1], &size);
+    if (!data || replay_open(data, size) != ESP_OK || passes < 1)
+    {
+        fprintf(stderr, "%s: cannot replay %s\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    const replay_header_t *header = data;
+    float rate = replay_sample_rate_hz();
+    detectors_init();
+    biquad_design_lowpass(&full_input.filter, DETECTOR_FILTER_STAGES,
+                          DETECTOR_FILTER_FULL_CUTOFF_HZ, rate);
+    biquad_design_lowpass(&decimated_input.filter, DETECTOR_FILTER_STAGES,
+                          DETECTOR_FILTER_DECIMATED_CUTOFF_HZ, rate);
+
+    unsigned long samples = (unsigned long)header->sample_count * passes;
+    double start = now_s();
+    for (unsigned long i = 0; i < samples; i++)
+    {
+        sensor_reading_t r = replay_next();
+        r.accel_range_g = replay_accel_range_g();
+        add_reading(&full_input, &r);
+        add_reading(&decimated_input, &r);
+    }
+    flush_block(&full_input);
+    flush_block(&decimated_input);
+    double s = now_s() - start;
+
+    double hours = samples / rate / 3600.0;
+    printf("%s detectors, %lu samples at %.0f Hz (%.1f min of driving)\n",
+           DETECTOR_FIXED_POINT ? "Q10 fixed-point" : "float", samples, rate, hours * 60.0);
+    printf("%.2f ns per sample, %.0fx real time\n", s * 1e9 / samples, hours * 3600.0 / s);
+    for (int d = 0; d < DETECTOR_COUNT; d++)
+    {
+        printf("%-16s %6lu alerts  %8.1f per hour\n", detector_get_name(d), alerts[d],
+               alerts[d] / hours);
+    }
+    printf("%lu episodes shown on the display\n", confirmations);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,6 @@
+#include "app_queues.h"
+
+TYPED_RING_BUFFER_DEFINE(sensor_queue, sensor_reading_t, SENSOR_QUEUE_SIZE,
+                         RING_BUFFER_SYNC_SPSC)
+TYPED_RING_BUFFER_DEFINE_WITH_POLICY(batch_queue, sensor_batch_t, BATCH_QUEUE_SIZE,
+                                     RING_BUFFER_SYNC_MUTEX, RING_BUFFER_DROP_NEWEST)
@@ -0,0 +1,20 @@
+#ifndef APP_QUEUES_H
+#define APP_QUEUES_H
+
+#include "message_types.h"
+#include "queue/typed_ring_buffer.hpp"
+
+// The two hot-path queues are typed: every item is the same struct, so the
+// copies and index wrap are fixed at compile time. main.c hands them out as
+// ring_buffer_t handles, so producers and consumers use the generic API.
+
+// Single producer (sensor task), single consumer (processing task)
+TYPED_RING_BUFFER_DECLARE(sensor_queue, sensor_reading_t);
+// Keeps the batches already queued while the uplink is down (drop-newest)
+TYPED_RING_BUFFER_DECLARE(batch_queue, sensor_batch_t);
+
+#define APP_QUEUES_RAM_BYTES                                          \
+    (TYPED_RING_BUFFER_BYTES(sensor_reading_t, SENSOR_QUEUE_SIZE) + \
+     TYPED_RING_BUFFER_BYTES(sensor_batch_t, BATCH_QUEUE_SIZE))
+
+#endif // APP_QUEUES_H
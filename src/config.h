@@ -20,14 +20,118 @@
 #define DEVICE_NAME "DriveMonitor"
 #endif
 
+// Boot-time IMU settings; the set_imu command changes them at runtime
 #define IMU_SAMPLE_RATE_HZ 100
-#define SENSOR_INTERVAL_MS (1000 / IMU_SAMPLE_RATE_HZ)
+#define IMU_SAMPLE_RATE_MIN_HZ 10  // Below this the data ready timeout fires
+#define IMU_SAMPLE_RATE_MAX_HZ 200 // Sizes the FIFO burst and sensor_rb
+#define IMU_ACCEL_RANGE_G 8        // +-2 g would saturate below the crash threshold
+
+// REPLAY_SENSOR_DATA plays a recorded drive from this flash partition in
+// place of the IMU, REPLAY_SPEED samples per sample period
+#define REPLAY_PARTITION_LABEL "trace"
+#ifndef REPLAY_SPEED
+#define REPLAY_SPEED 1
+#endif
+
+// MOCK_SENSOR_DATA synthesizes a drive from a seeded random mix of segments,
+// MOCK_SPEED samples per sample period. Weights are relative, in order:
+// idle, city, highway, pothole, harsh braking, cornering, crash, sensor fault.
+#ifndef MOCK_SCENARIO_WEIGHTS
+#define MOCK_SCENARIO_WEIGHTS {10, 40, 30, 8, 5, 5, 1, 1}
+#endif
+#ifndef MOCK_SCENARIO_SEED
+#define MOCK_SCENARIO_SEED 1
+#endif
+#ifndef MOCK_SPEED
+#define MOCK_SPEED 1
+#endif
+
+// Simulated sources run faster than real time by pushing several samples per
+// sample period
+#if defined(REPLAY_SENSOR_DATA)
+#define SENSOR_SAMPLES_PER_PERIOD REPLAY_SPEED
+#elif defined(MOCK_SENSOR_DATA)
+#define SENSOR_SAMPLES_PER_PERIOD MOCK_SPEED
+#else
+#define SENSOR_SAMPLES_PER_PERIOD 1
+#endif
+
+// Read the gyroscope and temperature in the same I2C burst as the
+// accelerometer. Adds 12 bytes per reading in sensor_rb and 6 per sample in
+// batch_rb.
+#ifndef SENSOR_GYRO_ENABLED
+#define SENSOR_GYRO_ENABLED 0
+#endif
+
+// Let the MPU6050 pace samples into its FIFO and read them in one burst per
+// wakeup, instead of one I2C transaction per sample
+#ifndef SENSOR_FIFO_ENABLED
+#define SENSOR_FIFO_ENABLED 1
+#endif
+
+// Run the IMU at a multiple of the sample rate, up to 1 kHz, and decimate
+// through an anti-alias FIR in processing. Detectors choose the full-rate or
+// the decimated stream; telemetry gets the decimated one. FIFO mode only.
+#ifndef IMU_OVERSAMPLE_ENABLED
+#define IMU_OVERSAMPLE_ENABLED SENSOR_FIFO_ENABLED
+#endif
+#define IMU_OVERSAMPLE_MAX 10       // Largest decimation factor
+#define IMU_RAW_RATE_MAX_HZ 1000    // MPU6050 accelerometer output rate
+#define DECIMATOR_TAPS_PER_PHASE 12 // FIR length is this times the factor
+
+#if IMU_OVERSAMPLE_ENABLED
+// Open enough for impulses to reach the full-rate stream; the FIR does the
+// anti-aliasing for telemetry
+#define IMU_DLPF_HZ 184
+// A 1 kB FIFO holds 73 ms of 14 byte frames at 1 kHz
+#define SENSOR_FIFO_READ_INTERVAL_MS 20
+#define SENSOR_FIFO_RATE_MAX_HZ IMU_RAW_RATE_MAX_HZ
+#else
+#define IMU_DLPF_HZ 44 // Below Nyquist at the default rate; 0 turns it off
+#define SENSOR_FIFO_READ_INTERVAL_MS 50
+#define SENSOR_FIFO_RATE_MAX_HZ IMU_SAMPLE_RATE_MAX_HZ
+#endif
+// Two read intervals' worth, so a late wakeup still drains in one burst
+#define SENSOR_FIFO_BURST_MAX (SENSOR_FIFO_RATE_MAX_HZ * SENSOR_FIFO_READ_INTERVAL_MS * 2 / 1000)
 
-#define SENSOR_QUEUE_SIZE 10
-#define MQTT_QUEUE_SIZE 20
+// Wake sensor_task from the MPU6050 INT pin once per sample, timestamped in
+// the ISR. Takes precedence over SENSOR_FIFO_ENABLED.
+#ifndef SENSOR_DATA_READY_ENABLED
+#define SENSOR_DATA_READY_ENABLED 0
+#endif
+#define SENSOR_DATA_READY_GPIO 27
+#define SENSOR_DATA_READY_TIMEOUT_MS 100 // Log if INT goes quiet this long
+
+// Mounting calibration (hardware only): gravity from a still window, then
+// heading from the first launch
+#define CALIBRATION_STILL_SAMPLES 200   // ~2 s at the default rate
+#define CALIBRATION_STILL_MAX_G 0.02f   // Per-axis stddev that still counts as still
+#define CALIBRATION_HEADING_MIN_G 0.1f  // Horizontal pull that counts as driving
+#define CALIBRATION_HEADING_SAMPLES 100 // Consecutive launch samples averaged for heading
+#define CALIBRATION_HEADING_SPREAD_DEG 15.0f // Max angle off the run's mean direction
+#define CALIBRATION_HEADING_MAX_YAW_DPS 5.0f // Gyro builds: faster yaw is a corner
+
+#if SENSOR_SAMPLES_PER_PERIOD > SENSOR_FIFO_BURST_MAX
+#define SENSOR_QUEUE_SIZE (2 * SENSOR_SAMPLES_PER_PERIOD)
+#else
+#define SENSOR_QUEUE_SIZE (2 * SENSOR_FIFO_BURST_MAX)
+#endif
+#define MQTT_CRASH_QUEUE_SIZE 5
+#define MQTT_QUEUE_SIZE 20 // Warnings
+#define MQTT_STATUS_QUEUE_SIZE 1 // Coalesced: only the latest is kept
 #define COMMAND_QUEUE_SIZE 5
-#define RESPONSE_QUEUE_SIZE 5
-#define BATCH_QUEUE_SIZE 3
+#define COMMAND_QUEUE_BLOCK_MS 50 // Producers wait this long for a free slot
+#define BATCH_QUEUE_SIZE 6 // Rides out ~30 s of uplink loss at 100 Hz
+// Static RAM for all queues, checked at compile time in main.c. batch_rb
+// dominates: BATCH_QUEUE_SIZE * LOG_BATCH_SIZE raw samples. Fast simulated
+// builds may need a larger budget for sensor_rb. On the ESP32 the queues
+// take ~22.4 kB, or ~40.9 kB with the gyro, whose batches are twice the size.
+#ifdef QUEUE_RAM_BUDGET_BYTES
+#elif SENSOR_GYRO_ENABLED
+#define QUEUE_RAM_BUDGET_BYTES (44 * 1024)
+#else
+#define QUEUE_RAM_BUDGET_BYTES (24 * 1024)
+#endif
 
 #define LOG_BATCH_SIZE 500
 
@@ -52,6 +156,41 @@
 #define DEFAULT_HARSH_BRAKING_THRESHOLD_G 2.0f
 #define DEFAULT_HARSH_ACCEL_THRESHOLD_G 1.5f
 #define DEFAULT_HARSH_CORNERING_THRESHOLD_G 2.0f
+// An episode starts above the threshold and ends below this fraction of it
+#define DETECTOR_EXIT_RATIO 0.8f
+#define DETECTOR_MAX_EPISODE_MS 10000 // Report one that never ends, e.g. a stuck axis
+
+// Butterworth low-pass ahead of each stream's detectors, of order 2 * stages,
+// against road vibration and sensor noise. 0 Hz passes samples through; crash
+// gets the unfiltered stream by default since impacts are brief.
+#define BIQUAD_MAX_STAGES 4
+#ifndef DETECTOR_FILTER_STAGES
+#define DETECTOR_FILTER_STAGES 2
+#endif
+#ifndef DETECTOR_FILTER_DECIMATED_CUTOFF_HZ
+#define DETECTOR_FILTER_DECIMATED_CUTOFF_HZ 10.0f
+#endif
+#ifndef DETECTOR_FILTER_FULL_CUTOFF_HZ
+#define DETECTOR_FILTER_FULL_CUTOFF_HZ 0.0f
+#endif
+// Filter whole blocks as they are flushed instead of each reading as it is
+// added; needs float blocks
+#ifndef DETECTOR_FILTER_BLOCK
+#define DETECTOR_FILTER_BLOCK 0
+#endif
+
+// Carry acceleration as Q10 integers (1/1024 g) from the driver's counts
+// through calibration, decimation, filtering and detection, instead of
+// floats, and batch telemetry at that resolution: every count at +-16 g,
+// every 16th at +-2 g, where the sensor resolves finer. Worth it on targets
+// without an FPU (ESP32-S2, ESP32-C3); the ESP32 has a single-precision one.
+// Gyro, temperature and the calibration estimate stay in float.
+#ifndef DETECTOR_FIXED_POINT
+#define DETECTOR_FIXED_POINT 0
+#endif
+#if DETECTOR_FILTER_BLOCK && DETECTOR_FIXED_POINT
+#error "DETECTOR_FILTER_BLOCK filters float blocks; use per-reading filtering with DETECTOR_FIXED_POINT"
+#endif
 
 #ifndef TRACE_CONTEXT_SWITCHES
 #define TRACE_CONTEXT_SWITCHES 0
@@ -65,4 +204,8 @@
 #define TRACE_STATS_INTERVAL_MS 5000
 #endif
 
+#ifndef TRACE_BENCHMARKS_ENABLED
+#define TRACE_BENCHMARKS_ENABLED 0
+#endif
+
 #endif
\ No newline at end of file
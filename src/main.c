@@ -11,16 +11,64 @@
 #include "sensor/sensor.h"
 #include "display/display_manager.hpp"
 #include "trace/trace.h"
+#include "trace/benchmark.h"
 #include "queue/ring_buffer.h"
+#include "queue/priority_queue.h"
+#include "app_queues.h"
 #include "watchdog/watchdog.h"
 
 static const char *TAG = "main";
 
 ring_buffer_t *sensor_rb = NULL;
 ring_buffer_t *batch_rb = NULL;
-ring_buffer_t *mqtt_rb = NULL;
+priority_queue_t *mqtt_rb = NULL;
 ring_buffer_t *mqtt_command_queue = NULL;
-ring_buffer_t *mqtt_response_queue = NULL;
+
+// Consecutive status responses collapse into the latest one
+static bool coalesce_status(void *newest, const void *item)
+{
+    mqtt_message_t *queued = newest;
+    const mqtt_message_t *msg = item;
+    if (queued->type != MSG_STATUS || msg->type != MSG_STATUS)
+        return false;
+    *queued = *msg;
+    return true;
+}
+
+static const priority_lane_config_t mqtt_lanes[MQTT_LANE_COUNT] = {
+    // Keep the first impact of a crash sequence rather than the aftershocks
+    [MQTT_LANE_CRASH] = {MQTT_CRASH_QUEUE_SIZE, {.policy = RING_BUFFER_DROP_NEWEST}},
+    [MQTT_LANE_WARNING] = {MQTT_QUEUE_SIZE, {.policy = RING_BUFFER_OVERWRITE_OLDEST}},
+    // Only the latest thresholds are worth sending
+    [MQTT_LANE_STATUS] = {MQTT_STATUS_QUEUE_SIZE,
+                          {.policy = RING_BUFFER_COALESCE, .coalesce = coalesce_status}},
+};
+
+// A command must not be lost to a newer one; the MQTT side waits instead
+static const ring_buffer_overflow_t command_overflow = {
+    .policy = RING_BUFFER_BLOCK,
+    .block_timeout = pdMS_TO_TICKS(COMMAND_QUEUE_BLOCK_MS),
+};
+
+// Queue memory is reserved at link time so the RAM layout does not depend on
+// heap fragmentation at boot. sensor_rb and batch_rb are typed queues
+// defined in app_queues.cpp.
+static priority_queue_t mqtt_rb_buffer;
+static mqtt_message_t mqtt_rb_storage[MQTT_CRASH_QUEUE_SIZE + MQTT_QUEUE_SIZE +
+                                      MQTT_STATUS_QUEUE_SIZE];
+static ring_buffer_t mqtt_command_queue_buffer;
+static StaticSemaphore_t mqtt_command_queue_mutex;
+static mqtt_command_t mqtt_command_queue_storage[COMMAND_QUEUE_SIZE];
+
+#define QUEUE_RAM_BYTES                                                            \
+    (APP_QUEUES_RAM_BYTES +                                                        \
+     sizeof(mqtt_rb_buffer) + sizeof(mqtt_rb_storage) +                            \
+     sizeof(mqtt_command_queue_buffer) + sizeof(mqtt_command_queue_mutex) +        \
+     sizeof(mqtt_command_queue_storage))
+
+_Static_assert(QUEUE_RAM_BYTES <= QUEUE_RAM_BUDGET_BYTES,
+               "Queues exceed QUEUE_RAM_BUDGET_BYTES: shrink LOG_BATCH_SIZE or the queue sizes");
+
 void app_main(void)
 {
     ESP_LOGI(TAG, "Driving Safety Monitor starting...");
@@ -43,19 +91,27 @@ void app_main(void)
     }
     ESP_LOGI(TAG, "I2C init successful");
 
-    mqtt_rb = ring_buffer_create(MQTT_QUEUE_SIZE, sizeof(mqtt_message_t));
-    batch_rb = ring_buffer_create(BATCH_QUEUE_SIZE, sizeof(sensor_batch_t));
-    sensor_rb = ring_buffer_create(SENSOR_QUEUE_SIZE, sizeof(sensor_reading_t));
-    mqtt_command_queue = ring_buffer_create(COMMAND_QUEUE_SIZE, sizeof(mqtt_command_t));
-    mqtt_response_queue = ring_buffer_create(RESPONSE_QUEUE_SIZE, sizeof(mqtt_command_t));
-    if (mqtt_rb == NULL || batch_rb == NULL || sensor_rb == NULL || 
-        mqtt_command_queue == NULL || mqtt_response_queue == NULL)
+    mqtt_rb = priority_queue_create_static(&mqtt_rb_buffer, mqtt_lanes, MQTT_LANE_COUNT,
+                                           sizeof(mqtt_message_t), mqtt_rb_storage);
+    // Keep the batches already queued while the uplink is down; the oldest
+    // ones are the start of the gap the backend has to fill
+    batch_rb = batch_queue_as_ring_buffer();
+    sensor_rb = sensor_queue_as_ring_buffer();
+    mqtt_command_queue = ring_buffer_create_static(&mqtt_command_queue_buffer,
+                                                   COMMAND_QUEUE_SIZE, sizeof(mqtt_command_t),
+                                                   RING_BUFFER_SYNC_MUTEX, &command_overflow,
+                                                   mqtt_command_queue_storage,
+                                                   &mqtt_command_queue_mutex);
+    if (mqtt_rb == NULL || batch_rb == NULL || sensor_rb == NULL ||
+        mqtt_command_queue == NULL)
     {
         ESP_LOGE(TAG, "Failed to create ring buffers");
         return;
     }
     ESP_LOGI(TAG, "Ring buffers created successfully");
 
+    trace_run_benchmarks();
+
     ESP_ERROR_CHECK(wifi_manager_init());
 
     ESP_ERROR_CHECK(mqtt_manager_init());
@@ -64,8 +120,9 @@ void app_main(void)
 
     display_init();
 
-    // Large stack due to JSON serialization of batches
-    xTaskCreate(mqtt_task, "mqtt", 16384, NULL, MQTT_TASK_PRIORITY, NULL);
+    // Batches are serialized in place from batch_rb into a static buffer,
+    // so the stack only has to cover snprintf and the MQTT client
+    xTaskCreate(mqtt_task, "mqtt", 6144, NULL, MQTT_TASK_PRIORITY, NULL);
     xTaskCreate(processing_task, "process", 4096, NULL, PROCESSING_TASK_PRIORITY, NULL);
     xTaskCreate(sensor_task, "sensor", 4096, NULL, SENSOR_TASK_PRIORITY, NULL);
     xTaskCreate(displayTask, "display", 8192, NULL, SCREEN_TASK_PRIORITY, NULL);
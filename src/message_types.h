@@ -3,82 +3,221 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <math.h>
 #include "config.h"
+#include "processing/detector_list.h"
 
 typedef struct ring_buffer ring_buffer_t;
+typedef struct priority_queue priority_queue_t;
 
 typedef enum {
     MSG_WARNING,
-    MSG_CRASH
+    MSG_CRASH,
+    MSG_STATUS
 } message_type_t;
 
+// mqtt_rb lanes, highest priority first
 typedef enum {
-    WARNING_HARSH_BRAKING,
-    WARNING_HARSH_ACCEL,
-    WARNING_HARSH_CORNERING
+    MQTT_LANE_CRASH,
+    MQTT_LANE_WARNING,
+    MQTT_LANE_STATUS,
+    MQTT_LANE_COUNT
+} mqtt_lane_t;
+
+static inline const char *mqtt_lane_to_string(mqtt_lane_t lane) {
+    switch (lane) {
+        case MQTT_LANE_CRASH:   return "crash";
+        case MQTT_LANE_WARNING: return "warning";
+        case MQTT_LANE_STATUS:  return "status";
+        default:                return "unknown";
+    }
+}
+
+// One per WARNING detector in DETECTOR_LIST, named after it
+#define WARNING_ENUM_CRASH(id)
+#define WARNING_ENUM_WARNING(id) WARNING_##id,
+typedef enum {
+#define X(id, name, kind, ...) WARNING_ENUM_##kind(id)
+    DETECTOR_LIST(X)
+#undef X
+    WARNING_COUNT
 } warning_event_t;
 
+#define WARNING_CASE_CRASH(id, name)
+#define WARNING_CASE_WARNING(id, name) case WARNING_##id: return name;
 static inline const char *warning_event_to_string(warning_event_t event) {
     switch (event) {
-        case WARNING_HARSH_BRAKING:   return "harsh_braking";
-        case WARNING_HARSH_ACCEL:     return "harsh_accel";
-        case WARNING_HARSH_CORNERING: return "harsh_cornering";
-        default:                      return "unknown";
+#define X(id, name, kind, ...) WARNING_CASE_##kind(id, name)
+        DETECTOR_LIST(X)
+#undef X
+        default: return "unknown";
     }
 }
 
+// Alerts describe a whole episode; timestamp is its first sample's time in
+// ticks since boot
 typedef struct {
     warning_event_t event;
     uint32_t timestamp;
-    float accel_x; // Lateral (cornering)
-    float accel_y; // Longitudinal (braking/acceleration)
+    uint32_t duration_ms;
+    float peak;    // Detector value furthest past the threshold
+    float accel_x; // Lateral (cornering), at the peak
+    float accel_y; // Longitudinal (braking/acceleration), at the peak
 } warning_data_t;
 
 typedef struct {
     uint32_t timestamp;
-    float accel_magnitude;
+    uint32_t duration_ms;
+    float accel_magnitude; // Peak
 } crash_data_t;
 
+// Every detector's threshold, by its DETECTOR_LIST setting name. Same order
+// as detector_type_t.
+typedef enum {
+#define X(id, ...) THRESHOLD_##id,
+    DETECTOR_LIST(X)
+#undef X
+    THRESHOLD_COUNT
+} threshold_type_t;
+
+static inline const char *threshold_type_to_string(threshold_type_t type) {
+    switch (type) {
+#define X(id, name, kind, signal, strm, min_ms, refract_ms, display, on_trigger, setting) \
+        case THRESHOLD_##id: return setting;
+        DETECTOR_LIST(X)
+#undef X
+        default: return "unknown";
+    }
+}
+
+typedef struct {
+    float threshold[THRESHOLD_COUNT]; // g
+} threshold_status_t;
+
 typedef struct {
     message_type_t type;
     union {
         warning_data_t warning;
         crash_data_t crash;
+        threshold_status_t status;
     } data;
 } mqtt_message_t;
 
+// Accelerometer axes of a reading: g as floats, or with DETECTOR_FIXED_POINT
+// Q10 int16 (1 g is 1024) from the driver's counts through to the detectors,
+// so nothing on that path needs an FPU. Q10 clamps at +-24 g, past anything
+// the +-16 g IMU reports on one axis, so a squared 3-axis magnitude fits an
+// int32.
+#if DETECTOR_FIXED_POINT
+typedef int16_t accel_t;
+#define ACCEL_ONE_G 1024
+#define ACCEL_MAX (24 * ACCEL_ONE_G)
+#else
+typedef float accel_t;
+#define ACCEL_ONE_G 1.0f
+#endif
+
+#if DETECTOR_FIXED_POINT
+static inline accel_t accel_clamp(int32_t v) {
+    return v > ACCEL_MAX ? ACCEL_MAX : v < -ACCEL_MAX ? -ACCEL_MAX : (accel_t)v;
+}
+#endif
+
+static inline float accel_to_g(accel_t v) {
+    return (float)v / ACCEL_ONE_G;
+}
+
+// For values that start out in g: synthetic readings and thresholds
+static inline accel_t accel_from_g(float g) {
+#if DETECTOR_FIXED_POINT
+    float v = g * ACCEL_ONE_G;
+    if (v >= ACCEL_MAX)
+        return ACCEL_MAX;
+    if (v <= -ACCEL_MAX)
+        return -ACCEL_MAX;
+    return (accel_t)lrintf(v);
+#else
+    return g;
+#endif
+}
+
+// Sensor counts at lsb_per_g, a power of two from 2048 (+-16 g) to 16384
+// (+-2 g). Integer only in fixed-point builds: the Q10 step is a whole number
+// of counts, lsb_per_g / 1024, so this rounds to that step and going back
+// gives its multiple. The round trip is exact only at +-16 g; at +-2 g
+// telemetry comes back quantized to 16 counts.
+static inline accel_t accel_from_counts(int32_t counts, int32_t lsb_per_g) {
+#if DETECTOR_FIXED_POINT
+    int32_t half = counts < 0 ? -lsb_per_g / 2 : lsb_per_g / 2;
+    return accel_clamp((counts * ACCEL_ONE_G + half) / lsb_per_g);
+#else
+    return (float)counts / lsb_per_g;
+#endif
+}
+
+static inline int16_t accel_to_counts(accel_t v, int32_t lsb_per_g) {
+#if DETECTOR_FIXED_POINT
+    int32_t counts = (int32_t)v * (lsb_per_g / ACCEL_ONE_G);
+#else
+    float counts = roundf(v * lsb_per_g);
+#endif
+    if (counts > INT16_MAX)
+        return INT16_MAX;
+    if (counts < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)counts;
+}
+
 typedef struct {
-    float x;
-    float y;
-    float z;
+    accel_t x;
+    accel_t y;
+    accel_t z;
+#if SENSOR_GYRO_ENABLED
+    float gx; // deg/s, same axes as the accelerometer
+    float gy;
+    float gz; // Yaw rate
+#endif
+    uint32_t timestamp_us; // esp_timer time of the sample, wraps every ~71 min
+    // Full-scale range the sample was read at. Readings queued before a
+    // set_imu range change keep their own telemetry scale.
+    uint8_t accel_range_g;
 } sensor_reading_t;
 
+// Telemetry keeps the sensor's int16 counts, half the size of floats; the
+// batch header carries the scales to convert them
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+#if SENSOR_GYRO_ENABLED
+    int16_t gx;
+    int16_t gy;
+    int16_t gz;
+#endif
+} sensor_raw_sample_t;
+
 typedef struct {
     uint32_t batch_start_timestamp;
     uint16_t sample_rate_hz;
     uint16_t sample_count;
-    sensor_reading_t samples[LOG_BATCH_SIZE];
+    float accel_lsb_per_g; // g = count / accel_lsb_per_g
+#if SENSOR_GYRO_ENABLED
+    float gyro_lsb_per_dps;
+    float temperature_c; // At batch start; it changes too slowly to log per sample
+#endif
+    sensor_raw_sample_t samples[LOG_BATCH_SIZE];
 } sensor_batch_t;
 
-typedef enum {
-    THRESHOLD_CRASH,
-    THRESHOLD_BRAKING,
-    THRESHOLD_ACCEL,
-    THRESHOLD_CORNERING
-} threshold_type_t;
-
 typedef enum {
     MQTT_CMD_SET_THRESHOLD,  // Set a threshold
     MQTT_CMD_GET_STATUS,     // Request current status
-    MQTT_RESP_STATUS          // Current thresholds response
+    MQTT_CMD_SET_IMU,        // Change IMU rate, range and filter
+    MQTT_CMD_CALIBRATE,      // Redo the mounting calibration
+    MQTT_CMD_SET_FILTER      // Change a detector input filter
 } mqtt_command_type_t;
 
-typedef struct {
-    float crash;
-    float braking;
-    float accel;
-    float cornering;
-} threshold_status_t;
+#define IMU_CONFIG_UNCHANGED 0xFFFF // set_imu field left out of the command
+#define FILTER_STAGES_UNCHANGED 0xFF // set_filter stages left out
 
 typedef struct {
     mqtt_command_type_t type;
@@ -87,14 +226,28 @@ typedef struct {
             threshold_type_t threshold;
             float value;
         } set_threshold;
-        threshold_status_t status;
+        struct {
+            uint16_t sample_rate_hz;
+            uint16_t accel_range_g;
+            uint16_t dlpf_hz;
+        } set_imu;
+        struct {
+            bool full_stream; // The crash stream rather than the decimated one
+            float cutoff_hz;
+            uint8_t stages;
+        } set_filter;
     } data;
 } mqtt_command_t;
 
 extern ring_buffer_t *sensor_rb;
 extern ring_buffer_t *batch_rb;
-extern ring_buffer_t *mqtt_rb;
-extern ring_buffer_t *mqtt_command_queue;  // Commands from MQTT to processing
-extern ring_buffer_t *mqtt_response_queue; // Responses from processing to MQTT
+extern priority_queue_t *mqtt_rb;         // Alerts and status, one lane per mqtt_lane_t
+extern ring_buffer_t *mqtt_command_queue; // Commands from MQTT to processing
+
+// Task notification bits the queues above set on their consumer task
+#define NOTIFY_SENSOR_DATA (1u << 0) // sensor_rb -> processing task
+#define NOTIFY_COMMAND (1u << 1)     // mqtt_command_queue -> processing task
+#define NOTIFY_ALERT (1u << 2)       // mqtt_rb -> mqtt task
+#define NOTIFY_BATCH (1u << 3)       // batch_rb -> mqtt task
 
 #endif // MESSAGE_TYPES_H
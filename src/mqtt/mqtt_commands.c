@@ -4,6 +4,8 @@
 #include "message_types.h"
 #include "queue/ring_buffer.h"
 #include "queue/ring_buffer_utils.h"
+#include "processing/biquad.h"
+#include "sensor/sensor.h"
 
 #include "mqtt_client.h"
 #include "esp_log.h"
@@ -62,7 +64,7 @@ static void handle_get_status(void)
 {
     mqtt_command_t cmd = {.type = MQTT_CMD_GET_STATUS};
     if (ring_buffer_push_back_with_full_log(mqtt_command_queue, &cmd,
-                                            "Command queue full, overwrote oldest command"))
+                                            "Command queue full, waited for space"))
     {
         ESP_LOGI(TAG, "Status request queued");
     }
@@ -88,22 +90,19 @@ static void handle_set_threshold(const char *json)
         .type = MQTT_CMD_SET_THRESHOLD,
         .data.set_threshold.value = value};
 
-    if (str_eq(type_str, type_len, "crash"))
-        cmd.data.set_threshold.threshold = THRESHOLD_CRASH;
-    else if (str_eq(type_str, type_len, "braking"))
-        cmd.data.set_threshold.threshold = THRESHOLD_BRAKING;
-    else if (str_eq(type_str, type_len, "accel"))
-        cmd.data.set_threshold.threshold = THRESHOLD_ACCEL;
-    else if (str_eq(type_str, type_len, "cornering"))
-        cmd.data.set_threshold.threshold = THRESHOLD_CORNERING;
-    else
+    int type = 0;
+    while (type < THRESHOLD_COUNT &&
+           !str_eq(type_str, type_len, threshold_type_to_string((threshold_type_t)type)))
+        type++;
+    if (type == THRESHOLD_COUNT)
     {
         ESP_LOGW(TAG, "Unknown threshold type: %.*s", type_len, type_str);
         return;
     }
+    cmd.data.set_threshold.threshold = (threshold_type_t)type;
 
     if (ring_buffer_push_back_with_full_log(mqtt_command_queue, &cmd,
-                                            "Command queue full, overwrote oldest command"))
+                                            "Command queue full, waited for space"))
     {
         ESP_LOGI(TAG, "Set %.*s threshold to %.1f", type_len, type_str, value);
     }
@@ -113,6 +112,122 @@ static void handle_set_threshold(const char *json)
     }
 }
 
+// Leaves *out at IMU_CONFIG_UNCHANGED if key is absent. Returns false if it
+// is negative or too large, which rejects the whole command: clamping would
+// turn e.g. "dlpf": -5 into 0, a valid setting.
+static bool imu_field(const char *json, const char *key, uint16_t *out)
+{
+    float value;
+    *out = IMU_CONFIG_UNCHANGED;
+    if (!json_get_float(json, key, &value))
+        return true;
+    if (value < 0.0f || value >= IMU_CONFIG_UNCHANGED)
+    {
+        ESP_LOGW(TAG, "set_imu %s out of range: %.1f", key, value);
+        return false;
+    }
+    *out = (uint16_t)value;
+    return true;
+}
+
+static void handle_set_imu(const char *json)
+{
+    mqtt_command_t cmd = {.type = MQTT_CMD_SET_IMU};
+    if (!imu_field(json, "rate", &cmd.data.set_imu.sample_rate_hz) ||
+        !imu_field(json, "range", &cmd.data.set_imu.accel_range_g) ||
+        !imu_field(json, "dlpf", &cmd.data.set_imu.dlpf_hz))
+    {
+        return;
+    }
+
+    if (cmd.data.set_imu.sample_rate_hz == IMU_CONFIG_UNCHANGED &&
+        cmd.data.set_imu.accel_range_g == IMU_CONFIG_UNCHANGED &&
+        cmd.data.set_imu.dlpf_hz == IMU_CONFIG_UNCHANGED)
+    {
+        ESP_LOGE(TAG, "set_imu needs at least one of rate, range, dlpf");
+        return;
+    }
+
+    if (ring_buffer_push_back_with_full_log(mqtt_command_queue, &cmd,
+                                            "Command queue full, waited for space"))
+    {
+        ESP_LOGI(TAG, "IMU config change queued");
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Failed to queue command");
+    }
+}
+
+static void handle_calibrate(void)
+{
+    mqtt_command_t cmd = {.type = MQTT_CMD_CALIBRATE};
+    if (ring_buffer_push_back_with_full_log(mqtt_command_queue, &cmd,
+                                            "Command queue full, waited for space"))
+    {
+        ESP_LOGI(TAG, "Calibration request queued");
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Failed to queue calibration request");
+    }
+}
+
+static void handle_set_filter(const char *json)
+{
+    mqtt_command_t cmd = {.type = MQTT_CMD_SET_FILTER};
+    if (!json_get_float(json, "cutoff", &cmd.data.set_filter.cutoff_hz))
+    {
+        ESP_LOGE(TAG, "set_filter missing cutoff");
+        return;
+    }
+
+    int stream_len;
+    const char *stream = json_get_string(json, "stream", &stream_len);
+    if (stream && str_eq(stream, stream_len, "full"))
+        cmd.data.set_filter.full_stream = true;
+    else if (stream && !str_eq(stream, stream_len, "decimated"))
+    {
+        ESP_LOGW(TAG, "Unknown filter stream: %.*s", stream_len, stream);
+        return;
+    }
+
+    // The filter would take a cutoff it cannot design as "off"
+    float rate = sensor_get_sample_rate_hz();
+    if (cmd.data.set_filter.full_stream)
+        rate *= sensor_get_oversample();
+    float cutoff = cmd.data.set_filter.cutoff_hz;
+    if (!(cutoff >= 0.0f && cutoff < BIQUAD_NYQUIST_MARGIN * rate)) // NaN too
+    {
+        ESP_LOGW(TAG, "set_filter cutoff must be 0 (off) or under %.1f Hz at %.0f Hz",
+                 BIQUAD_NYQUIST_MARGIN * rate, rate);
+        return;
+    }
+
+    float stages;
+    cmd.data.set_filter.stages = FILTER_STAGES_UNCHANGED;
+    if (json_get_float(json, "stages", &stages))
+    {
+        if (!(stages >= 1.0f && stages <= BIQUAD_MAX_STAGES) || stages != (float)(int)stages)
+        {
+            ESP_LOGW(TAG, "set_filter stages must be a whole number from 1 to %d",
+                     BIQUAD_MAX_STAGES);
+            return;
+        }
+        cmd.data.set_filter.stages = (uint8_t)stages;
+    }
+
+    if (ring_buffer_push_back_with_full_log(mqtt_command_queue, &cmd,
+                                            "Command queue full, waited for space"))
+    {
+        ESP_LOGI(TAG, "Filter change queued");
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Failed to queue command");
+    }
+}
+
 // --- Public API ---
 
 void mqtt_publish_status(const threshold_status_t *status)
@@ -128,8 +243,7 @@ void mqtt_publish_status(const threshold_status_t *status)
 
     if (msg_id >= 0)
     {
-        ESP_LOGI(TAG, "Thresholds: crash=%.1f braking=%.1f accel=%.1f cornering=%.1f",
-                 status->crash, status->braking, status->accel, status->cornering);
+        ESP_LOGI(TAG, "Thresholds: %s", json);
     }
     else
     {
@@ -164,6 +278,18 @@ void mqtt_handle_command(const char *data, int data_len)
     {
         handle_set_threshold(s_cmd_buffer);
     }
+    else if (str_eq(cmd_str, cmd_len, "set_imu"))
+    {
+        handle_set_imu(s_cmd_buffer);
+    }
+    else if (str_eq(cmd_str, cmd_len, "calibrate"))
+    {
+        handle_calibrate();
+    }
+    else if (str_eq(cmd_str, cmd_len, "set_filter"))
+    {
+        handle_set_filter(s_cmd_buffer);
+    }
     else
     {
         ESP_LOGW(TAG, "Unknown command: %.*s", cmd_len, cmd_str);
@@ -5,6 +5,8 @@
 #include "message_types.h"
 #include "queue/ring_buffer.h"
 #include "queue/ring_buffer_utils.h"
+#include "queue/priority_queue.h"
+#include "sensor/calibration.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -15,55 +17,63 @@
 
 static const char *TAG = "mqtt_task";
 
-static void process_mqtt_responses(void)
+// Upper bound on how long a pending status request waits to be noticed
+#define IDLE_WAKEUP_MS 1000
+
+static void publish_alert(const mqtt_message_t *alert_msg)
 {
-    mqtt_command_t response;
-    while (ring_buffer_pop_front(mqtt_response_queue, &response))
+    const char *json_payload = serialize_alert(alert_msg);
+    if (json_payload == NULL)
     {
-        if (response.type == MQTT_RESP_STATUS)
-        {
-            mqtt_publish_status(&response.data.status);
-        }
+        ESP_LOGE(TAG, "Failed to serialize alert");
+        return;
+    }
+
+    int msg_id = esp_mqtt_client_publish(
+        g_mqtt_client, MQTT_TOPIC_ALERTS, json_payload, 0, MQTT_QOS_ALERTS, 0);
+
+    if (msg_id >= 0)
+    {
+        ESP_LOGI(TAG, "Alert published: %s",
+                 alert_msg->type == MSG_CRASH ? "CRASH" : "WARNING");
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Failed to publish alert");
     }
 }
 
-static void process_alerts(void)
+static void process_messages(void)
 {
-    mqtt_message_t alert_msg;
-    while (ring_buffer_pop_front(mqtt_rb, &alert_msg))
+    mqtt_message_t msg;
+    while (priority_queue_pop(mqtt_rb, &msg, NULL))
     {
-        const char *json_payload = serialize_alert(&alert_msg);
-        if (json_payload == NULL)
+        if (msg.type == MSG_STATUS)
         {
-            ESP_LOGE(TAG, "Failed to serialize alert");
-            continue;
-        }
-
-        int msg_id = esp_mqtt_client_publish(
-            g_mqtt_client, MQTT_TOPIC_ALERTS, json_payload, 0, MQTT_QOS_ALERTS, 0);
-
-        if (msg_id >= 0)
-        {
-            ESP_LOGI(TAG, "Alert published: %s",
-                     alert_msg.type == MSG_CRASH ? "CRASH" : "WARNING");
+            mqtt_publish_status(&msg.data.status);
         }
         else
         {
-            ESP_LOGE(TAG, "Failed to publish alert");
+            publish_alert(&msg);
         }
     }
 }
 
 static void process_telemetry(void)
 {
-    sensor_batch_t batch;
-    if (ring_buffer_pop_front(batch_rb, &batch))
+    // Serialize straight out of batch_rb; the slot is freed once the JSON
+    // is in the serializer's static buffer
+    const sensor_batch_t *batch;
+    while ((batch = ring_buffer_borrow_front(batch_rb)) != NULL)
     {
-        const char *json_payload = serialize_batch(&batch);
+        const char *json_payload = serialize_batch(batch);
+        uint16_t sample_count = batch->sample_count;
+        ring_buffer_release_front(batch_rb);
+
         if (json_payload == NULL)
         {
             ESP_LOGE(TAG, "Failed to serialize batch");
-            return;
+            continue;
         }
 
         int msg_id = esp_mqtt_client_publish(
@@ -71,7 +81,7 @@ static void process_telemetry(void)
 
         if (msg_id >= 0)
         {
-            ESP_LOGI(TAG, "Batch published, samples=%d", batch.sample_count);
+            ESP_LOGI(TAG, "Batch published, samples=%d", sample_count);
         }
         else
         {
@@ -85,7 +95,7 @@ static void request_initial_status(void)
     mqtt_command_t status_req = {
         .type = MQTT_CMD_GET_STATUS};
     if (ring_buffer_push_back_with_full_log(mqtt_command_queue, &status_req,
-                                            "Command queue full, overwrote oldest command"))
+                                            "Command queue full, waited for space"))
     {
         ESP_LOGI(TAG, "Requested initial status");
     }
@@ -100,9 +110,14 @@ void mqtt_task(void *pvParameters)
     (void)pvParameters;
     ESP_LOGI(TAG, "mqtt_task started");
 
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    priority_queue_set_consumer(mqtt_rb, self, NOTIFY_ALERT);
+    ring_buffer_set_consumer(batch_rb, self, NOTIFY_BATCH);
+
     while (1)
     {
         TRACE_TASK_RUN(TAG);
+        calibration_store_pending(); // Connected or not
 
         if (!mqtt_manager_is_connected())
         {
@@ -116,8 +131,10 @@ void mqtt_task(void *pvParameters)
             request_initial_status();
         }
 
-        process_mqtt_responses();
-        process_alerts();
+        // Drain every queue on each wakeup; which one notified does not matter
+        process_messages();
         process_telemetry();
+
+        xTaskNotifyWait(0, UINT32_MAX, NULL, pdMS_TO_TICKS(IDLE_WAKEUP_MS));
     }
 }
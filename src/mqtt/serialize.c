@@ -12,8 +12,14 @@ static const char *TAG = "serialize";
 static char s_alert_buffer[ALERT_BUFFER_SIZE];
 
 // Static buffer for batch JSON
-// Estimate: header ~50 bytes + 500 samples * ~30 bytes each = ~15KB
-#define BATCH_BUFFER_SIZE (50 + (LOG_BATCH_SIZE * 35))
+// Estimate: header ~110 bytes + 500 samples of up to 23 bytes each
+// ("[-32768,-32768,-32768],") = ~12KB, plus 21 bytes per sample for the gyro
+#if SENSOR_GYRO_ENABLED
+#define BATCH_SAMPLE_SIZE 44
+#else
+#define BATCH_SAMPLE_SIZE 23
+#endif
+#define BATCH_BUFFER_SIZE (128 + (LOG_BATCH_SIZE * BATCH_SAMPLE_SIZE))
 static char s_batch_buffer[BATCH_BUFFER_SIZE];
 
 const char *serialize_alert(const mqtt_message_t *msg) {
@@ -21,17 +27,21 @@ const char *serialize_alert(const mqtt_message_t *msg) {
 
     if (msg->type == MSG_WARNING) {
         len = snprintf(s_alert_buffer, ALERT_BUFFER_SIZE,
-            "{\"dev\":\"%s\",\"type\":\"warning\",\"event\":\"%s\",\"ts\":%lu,\"x\":%.3f,\"y\":%.3f}",
+            "{\"dev\":\"%s\",\"type\":\"warning\",\"event\":\"%s\",\"ts\":%lu,\"dur\":%lu,"
+            "\"peak\":%.3f,\"x\":%.3f,\"y\":%.3f}",
             g_device_id,
             warning_event_to_string(msg->data.warning.event),
             (unsigned long)msg->data.warning.timestamp,
+            (unsigned long)msg->data.warning.duration_ms,
+            msg->data.warning.peak,
             msg->data.warning.accel_x,
             msg->data.warning.accel_y);
     } else if (msg->type == MSG_CRASH) {
         len = snprintf(s_alert_buffer, ALERT_BUFFER_SIZE,
-            "{\"dev\":\"%s\",\"type\":\"crash\",\"ts\":%lu,\"mag\":%.3f}",
+            "{\"dev\":\"%s\",\"type\":\"crash\",\"ts\":%lu,\"dur\":%lu,\"mag\":%.3f}",
             g_device_id,
             (unsigned long)msg->data.crash.timestamp,
+            (unsigned long)msg->data.crash.duration_ms,
             msg->data.crash.accel_magnitude);
     } else {
         return NULL;
@@ -50,12 +60,26 @@ const char *serialize_batch(const sensor_batch_t *batch) {
     char *end = s_batch_buffer + BATCH_BUFFER_SIZE;
     int written;
 
+#if SENSOR_GYRO_ENABLED
     written = snprintf(ptr, end - ptr,
-        "{\"dev\":\"%s\",\"ts\":%lu,\"rate\":%u,\"n\":%u,\"d\":[",
+        "{\"dev\":\"%s\",\"ts\":%lu,\"rate\":%u,\"n\":%u,\"scale\":%.1f,"
+        "\"gscale\":%.1f,\"temp\":%.1f,\"d\":[",
         g_device_id,
         (unsigned long)batch->batch_start_timestamp,
         batch->sample_rate_hz,
-        batch->sample_count);
+        batch->sample_count,
+        batch->accel_lsb_per_g,
+        batch->gyro_lsb_per_dps,
+        batch->temperature_c);
+#else
+    written = snprintf(ptr, end - ptr,
+        "{\"dev\":\"%s\",\"ts\":%lu,\"rate\":%u,\"n\":%u,\"scale\":%.1f,\"d\":[",
+        g_device_id,
+        (unsigned long)batch->batch_start_timestamp,
+        batch->sample_rate_hz,
+        batch->sample_count,
+        batch->accel_lsb_per_g);
+#endif
 
     if (written < 0 || ptr + written >= end) {
         ESP_LOGE(TAG, "Batch header overflow");
@@ -64,12 +88,19 @@ const char *serialize_batch(const sensor_batch_t *batch) {
     ptr += written;
 
     for (uint16_t i = 0; i < batch->sample_count; i++) {
+        const sensor_raw_sample_t *s = &batch->samples[i];
+#if SENSOR_GYRO_ENABLED
+        // Gyro follows the accelerometer, so [x,y,z] readers still work
         written = snprintf(ptr, end - ptr,
-            "%s[%.4f,%.4f,%.4f]",
+            "%s[%d,%d,%d,%d,%d,%d]",
             (i > 0) ? "," : "",
-            batch->samples[i].x,
-            batch->samples[i].y,
-            batch->samples[i].z);
+            s->x, s->y, s->z, s->gx, s->gy, s->gz);
+#else
+        written = snprintf(ptr, end - ptr,
+            "%s[%d,%d,%d]",
+            (i > 0) ? "," : "",
+            s->x, s->y, s->z);
+#endif
 
         if (written < 0 || ptr + written >= end) {
             ESP_LOGE(TAG, "Batch overflow at sample %u", i);
@@ -87,19 +118,21 @@ const char *serialize_batch(const sensor_batch_t *batch) {
     return s_batch_buffer;
 }
 
-// Static buffer for status JSON
-#define STATUS_BUFFER_SIZE 128
+// Static buffer for status JSON: the device id, then up to 24 characters
+// per threshold
+#define STATUS_BUFFER_SIZE (16 + DEVICE_ID_LEN + 24 * THRESHOLD_COUNT)
 static char s_status_buffer[STATUS_BUFFER_SIZE];
 
 const char *serialize_status(const threshold_status_t *status)
 {
-    int len = snprintf(s_status_buffer, STATUS_BUFFER_SIZE,
-                       "{\"dev\":\"%s\",\"crash\":%.1f,\"braking\":%.1f,\"accel\":%.1f,\"cornering\":%.1f}",
-                       g_device_id,
-                       status->crash,
-                       status->braking,
-                       status->accel,
-                       status->cornering);
+    int len = snprintf(s_status_buffer, STATUS_BUFFER_SIZE, "{\"dev\":\"%s\"", g_device_id);
+    for (int t = 0; t < THRESHOLD_COUNT && len >= 0 && len < STATUS_BUFFER_SIZE; t++)
+    {
+        len += snprintf(s_status_buffer + len, STATUS_BUFFER_SIZE - len, ",\"%s\":%.1f",
+                        threshold_type_to_string((threshold_type_t)t), status->threshold[t]);
+    }
+    if (len >= 0 && len < STATUS_BUFFER_SIZE)
+        len += snprintf(s_status_buffer + len, STATUS_BUFFER_SIZE - len, "}");
 
     if (len < 0 || len >= STATUS_BUFFER_SIZE)
     {
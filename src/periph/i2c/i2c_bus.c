@@ -1,53 +1,273 @@
 #include "i2c_bus.h"
-#include "driver/i2c.h"
+#include "driver/i2c_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 
 static const char *TAG = "i2c_bus";
 
-esp_err_t i2c_bus_init(void) {
-    esp_err_t ret;
+// Completions arrive in submission order, so pending transactions form a
+// FIFO. Each slot also holds the bytes written, which the driver reads
+// after the submit call has returned.
+typedef struct {
+    uint8_t tx[2];
+    i2c_bus_done_cb_t done;
+    void *arg;
+} i2c_txn_t;
 
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA,
-        .scl_io_num = I2C_MASTER_SCL,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
-        .clk_flags = 0
+static i2c_master_bus_handle_t bus = NULL;
+static struct {
+    uint8_t addr;
+    i2c_master_dev_handle_t handle;
+} devices[I2C_MAX_DEVICES];
+static size_t device_count = 0;
+
+static portMUX_TYPE txn_lock = portMUX_INITIALIZER_UNLOCKED;
+static i2c_txn_t txns[I2C_QUEUE_DEPTH];
+static size_t txn_head = 0;
+static size_t txn_count = 0;
+// Leading slots dropped by i2c_bus_recover. The driver may still finish
+// them; their completions pop the slots without calling back.
+static size_t txn_stale = 0;
+
+static StaticSemaphore_t sync_done_buffer;
+static SemaphoreHandle_t sync_done = NULL;
+static volatile esp_err_t sync_result;
+static uint32_t timeout_ms = I2C_TIMEOUT_MS;
+
+static bool IRAM_ATTR on_trans_done(i2c_master_dev_handle_t dev,
+                                    const i2c_master_event_data_t *evt, void *user_ctx) {
+    (void)dev;
+    (void)user_ctx;
+
+    // Completions for transactions i2c_bus_recover dropped come first
+    taskENTER_CRITICAL_ISR(&txn_lock);
+    if (txn_count == 0) {
+        taskEXIT_CRITICAL_ISR(&txn_lock);
+        return false;
+    }
+    i2c_txn_t txn = txns[txn_head];
+    txn_head = (txn_head + 1) % I2C_QUEUE_DEPTH;
+    txn_count--;
+    bool stale = txn_stale > 0;
+    if (stale) {
+        txn_stale--;
+    }
+    taskEXIT_CRITICAL_ISR(&txn_lock);
+    if (stale) {
+        return false;
+    }
+
+    esp_err_t result;
+    switch (evt->event) {
+        case I2C_EVENT_DONE:
+            result = ESP_OK;
+            break;
+        case I2C_EVENT_NACK:
+            result = ESP_FAIL;
+            break;
+        default:
+            result = ESP_ERR_TIMEOUT;
+            break;
+    }
+    return txn.done ? txn.done(result, txn.arg) : false;
+}
+
+static bool IRAM_ATTR on_sync_done(esp_err_t result, void *arg) {
+    (void)arg;
+    BaseType_t woken = pdFALSE;
+    sync_result = result;
+    xSemaphoreGiveFromISR(sync_done, &woken);
+    return woken == pdTRUE;
+}
+
+static i2c_master_dev_handle_t get_device(uint8_t dev_addr) {
+    for (size_t i = 0; i < device_count; i++) {
+        if (devices[i].addr == dev_addr) {
+            return devices[i].handle;
+        }
+    }
+    if (device_count == I2C_MAX_DEVICES) {
+        ESP_LOGE(TAG, "No room for device 0x%02x", dev_addr);
+        return NULL;
+    }
+
+    const i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = dev_addr,
+        .scl_speed_hz = I2C_MASTER_FREQ_HZ,
     };
+    const i2c_master_event_callbacks_t cbs = {.on_trans_done = on_trans_done};
 
-    ret = i2c_param_config(I2C_MASTER_NUM, &conf);
+    i2c_master_dev_handle_t handle;
+    esp_err_t ret = i2c_master_bus_add_device(bus, &dev_cfg, &handle);
+    if (ret == ESP_OK) {
+        ret = i2c_master_register_event_callbacks(handle, &cbs, NULL);
+    }
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C param config failed: %s", esp_err_to_name(ret));
-        return ret;
+        ESP_LOGE(TAG, "Failed to add device 0x%02x: %s", dev_addr, esp_err_to_name(ret));
+        return NULL;
     }
 
-    ret = i2c_driver_install(I2C_MASTER_NUM, I2C_MODE_MASTER, 0, 0, 0);
-    if (ret == ESP_ERR_INVALID_STATE) {
+    devices[device_count].addr = dev_addr;
+    devices[device_count].handle = handle;
+    device_count++;
+    return handle;
+}
+
+// Reserves the next slot; the caller submits, then drops it again on failure
+static i2c_txn_t *txn_push(i2c_bus_done_cb_t done, void *arg) {
+    i2c_txn_t *txn = NULL;
+    taskENTER_CRITICAL(&txn_lock);
+    if (txn_count < I2C_QUEUE_DEPTH) {
+        txn = &txns[(txn_head + txn_count) % I2C_QUEUE_DEPTH];
+        txn->done = done;
+        txn->arg = arg;
+        txn_count++;
+    }
+    taskEXIT_CRITICAL(&txn_lock);
+    return txn;
+}
+
+static void txn_unpush(void) {
+    taskENTER_CRITICAL(&txn_lock);
+    txn_count--;
+    taskEXIT_CRITICAL(&txn_lock);
+}
+
+esp_err_t i2c_bus_init(void) {
+    if (bus != NULL) {
         ESP_LOGI(TAG, "I2C already initialized");
         return ESP_OK;
     }
+
+    const i2c_master_bus_config_t conf = {
+        .i2c_port = I2C_MASTER_NUM,
+        .sda_io_num = I2C_MASTER_SDA,
+        .scl_io_num = I2C_MASTER_SCL,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .trans_queue_depth = I2C_QUEUE_DEPTH, // Non-zero selects async mode
+        .flags.enable_internal_pullup = true,
+    };
+
+    esp_err_t ret = i2c_new_master_bus(&conf, &bus);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C driver install failed: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "I2C bus init failed: %s", esp_err_to_name(ret));
         return ret;
     }
 
+    sync_done = xSemaphoreCreateBinaryStatic(&sync_done_buffer);
+
     ESP_LOGI(TAG, "I2C bus initialised");
     return ESP_OK;
 }
 
+esp_err_t i2c_bus_write_byte_async(uint8_t dev_addr, uint8_t reg, uint8_t data,
+                                   i2c_bus_done_cb_t done, void *arg) {
+    i2c_master_dev_handle_t dev = get_device(dev_addr);
+    if (dev == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c_txn_t *txn = txn_push(done, arg);
+    if (txn == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    txn->tx[0] = reg;
+    txn->tx[1] = data;
+    // Returns once queued; timeout_ms only bounds the wait for a queue slot
+    esp_err_t ret = i2c_master_transmit(dev, txn->tx, 2, timeout_ms);
+    if (ret != ESP_OK) {
+        txn_unpush();
+    }
+    return ret;
+}
+
+esp_err_t i2c_bus_read_bytes_async(uint8_t dev_addr, uint8_t reg, uint8_t *data, size_t len,
+                                   i2c_bus_done_cb_t done, void *arg) {
+    i2c_master_dev_handle_t dev = get_device(dev_addr);
+    if (dev == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    i2c_txn_t *txn = txn_push(done, arg);
+    if (txn == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    txn->tx[0] = reg;
+    esp_err_t ret = i2c_master_transmit_receive(dev, txn->tx, 1, data, len, timeout_ms);
+    if (ret != ESP_OK) {
+        txn_unpush();
+    }
+    return ret;
+}
+
+// Time on the wire for a transaction moving bytes data bytes: address and
+// register bytes, a repeated start and address for reads, 9 clocks a byte
+static uint32_t transfer_ms(size_t bytes) {
+    uint32_t bits = (bytes + 3) * 9;
+    return (bits * 1000 + I2C_MASTER_FREQ_HZ - 1) / I2C_MASTER_FREQ_HZ;
+}
+
+static esp_err_t wait_sync(esp_err_t submitted, size_t bytes) {
+    if (submitted != ESP_OK) {
+        return submitted;
+    }
+    // The extra tick covers a wait that starts just before a tick boundary,
+    // and keeps a wait shorter than a tick from being 0
+    uint32_t wait_ms = timeout_ms + transfer_ms(bytes);
+    if (xSemaphoreTake(sync_done, pdMS_TO_TICKS(wait_ms) + 1) != pdTRUE) {
+        ESP_LOGW(TAG, "Transaction timed out after %lu ms", (unsigned long)wait_ms);
+        i2c_bus_recover();
+        return ESP_ERR_TIMEOUT;
+    }
+    return sync_result;
+}
+
 esp_err_t i2c_bus_write_byte(uint8_t dev_addr, uint8_t reg, uint8_t data) {
-    uint8_t buf[2] = {reg, data};
-    return i2c_master_write_to_device(
-        I2C_MASTER_NUM, dev_addr, buf, sizeof(buf),
-        pdMS_TO_TICKS(I2C_TIMEOUT_MS)
-    );
+    return wait_sync(i2c_bus_write_byte_async(dev_addr, reg, data, on_sync_done, NULL), 1);
 }
 
 esp_err_t i2c_bus_read_bytes(uint8_t dev_addr, uint8_t reg, uint8_t *data, size_t len) {
-    return i2c_master_write_read_device(
-        I2C_MASTER_NUM, dev_addr, &reg, 1, data, len,
-        pdMS_TO_TICKS(I2C_TIMEOUT_MS)
-    );
+    return wait_sync(i2c_bus_read_bytes_async(dev_addr, reg, data, len, on_sync_done, NULL),
+                     len);
+}
+
+void i2c_bus_set_timeout_ms(uint32_t ms) {
+    timeout_ms = ms > 0 ? ms : 1;
+}
+
+esp_err_t i2c_bus_recover(void) {
+    // Everything queued so far is dropped; its completions are discarded
+    taskENTER_CRITICAL(&txn_lock);
+    txn_stale = txn_count;
+    taskEXIT_CRITICAL(&txn_lock);
+
+    // A completion that landed before the slots were marked must not satisfy
+    // the next wait
+    xSemaphoreTake(sync_done, 0);
+
+    // Toggles SCL until the slave releases SDA, then sends a STOP
+    esp_err_t ret = i2c_master_bus_reset(bus);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Bus recovery failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Don't return while the driver may still write into a dropped caller's
+    // buffer. Once it is idle no more completions can come, so slots it
+    // finished without a callback are freed too.
+    ret = i2c_master_bus_wait_all_done(bus, I2C_RECOVER_WAIT_MS);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Dropped transactions still in flight: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    taskENTER_CRITICAL(&txn_lock);
+    txn_count = 0;
+    txn_stale = 0;
+    taskEXIT_CRITICAL(&txn_lock);
+
+    ESP_LOGW(TAG, "Bus recovered");
+    return ESP_OK;
 }
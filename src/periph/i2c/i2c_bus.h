@@ -1,14 +1,42 @@
 #pragma once
 #include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define I2C_MASTER_NUM      I2C_NUM_0
 #define I2C_MASTER_SDA      26
 #define I2C_MASTER_SCL      25
 #define I2C_MASTER_FREQ_HZ  400000
-#define I2C_TIMEOUT_MS      1000
+#define I2C_TIMEOUT_MS      50   // Default slack on top of the transfer time
+#define I2C_RECOVER_WAIT_MS 100  // Wait for dropped transactions to drain
+#define I2C_QUEUE_DEPTH     4    // Transactions in flight at once
+#define I2C_MAX_DEVICES     2
+
+// Runs in ISR context when a queued transaction finishes. Return true if it
+// woke a higher priority task.
+typedef bool (*i2c_bus_done_cb_t)(esp_err_t result, void *arg);
 
 esp_err_t i2c_bus_init(void);
 
+// Queue a transaction and return at once; done is called when it finishes.
+// data must stay valid until then. ESP_ERR_NO_MEM if the queue is full.
+esp_err_t i2c_bus_write_byte_async(uint8_t dev_addr, uint8_t reg, uint8_t data,
+                                   i2c_bus_done_cb_t done, void *arg);
+esp_err_t i2c_bus_read_bytes_async(uint8_t dev_addr, uint8_t reg, uint8_t *data, size_t len,
+                                   i2c_bus_done_cb_t done, void *arg);
+
+// Queue a transaction and wait for it: its time on the wire at
+// I2C_MASTER_FREQ_HZ plus the bus timeout, rounded up by a tick. On timeout
+// the bus is recovered and ESP_ERR_TIMEOUT returned. One caller at a time.
 esp_err_t i2c_bus_write_byte(uint8_t dev_addr, uint8_t reg, uint8_t data);
 esp_err_t i2c_bus_read_bytes(uint8_t dev_addr, uint8_t reg, uint8_t *data, size_t len);
+
+// Slack the blocking calls allow past the transfer time, e.g. one sample
+// period
+void i2c_bus_set_timeout_ms(uint32_t timeout_ms);
+
+// Clocks out a stuck slave and drops queued transactions without calling
+// their callbacks. Waits up to I2C_RECOVER_WAIT_MS for the driver to finish
+// with them, so their buffers are free again once this returns ESP_OK.
+esp_err_t i2c_bus_recover(void);
@@ -1,10 +1,50 @@
 #include "mpu6050.h"
 #include "../i2c_bus.h"
-#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_log.h"
 
 static const char *TAG = "mpu6050";
 
+// Burst target for mpu6050_fifo_read_accel; a full FIFO fits in one read
+static uint8_t fifo_buf[MPU6050_FIFO_SIZE];
+static size_t fifo_frame_size = MPU6050_FIFO_ACCEL_FRAME;
+static bool fifo_enabled = false;
+
+// Follows ACCEL_CONFIG; read by every decode
+static float accel_scale = MPU6050_ACCEL_SCALE_2G;
+
+static inline int16_t be16(const uint8_t *p) {
+    return (int16_t)((p[0] << 8) | p[1]);
+}
+
+static void decode_accel(const uint8_t *f, mpu6050_accel_t *out) {
+    out->x = be16(&f[0]) / accel_scale;
+    out->y = be16(&f[2]) / accel_scale;
+    out->z = be16(&f[4]) / accel_scale;
+}
+
+static void decode_motion(const uint8_t *f, mpu6050_motion_t *out) {
+    decode_accel(f, &out->accel);
+    out->temp_c = be16(&f[6]) / MPU6050_TEMP_SCALE + MPU6050_TEMP_OFFSET;
+    out->gyro.x = be16(&f[8]) / MPU6050_GYRO_SCALE;
+    out->gyro.y = be16(&f[10]) / MPU6050_GYRO_SCALE;
+    out->gyro.z = be16(&f[12]) / MPU6050_GYRO_SCALE;
+}
+
+static void decode_counts(const uint8_t *f, bool motion, mpu6050_counts_t *out) {
+    for (int i = 0; i < 3; i++) {
+        out->accel[i] = be16(&f[2 * i]);
+    }
+    if (!motion) {
+        return;
+    }
+    out->temp = be16(&f[6]);
+    for (int i = 0; i < 3; i++) {
+        out->gyro[i] = be16(&f[8 + 2 * i]);
+    }
+}
+
 esp_err_t mpu6050_init(void) {
     vTaskDelay(pdMS_TO_TICKS(100));
 
@@ -19,6 +59,9 @@ esp_err_t mpu6050_init(void) {
     vTaskDelay(pdMS_TO_TICKS(10));
 
     ret = i2c_bus_write_byte(MPU6050_ADDR, MPU6050_ACCEL_CONFIG, 0x00);
+    if (ret == ESP_OK) {
+        ret = i2c_bus_write_byte(MPU6050_ADDR, MPU6050_GYRO_CONFIG, 0x00);
+    }
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to configure MPU6050: %s", esp_err_to_name(ret));
         return ret;
@@ -28,21 +71,200 @@ esp_err_t mpu6050_init(void) {
     return ESP_OK;
 }
 
-void mpu6050_read_accel(float *ax, float *ay, float *az) {
+esp_err_t mpu6050_read_accel(float *ax, float *ay, float *az) {
     uint8_t data[6];
     esp_err_t ret = i2c_bus_read_bytes(MPU6050_ADDR, MPU6050_ACCEL_XOUT_H, data, 6);
 
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Accel read failed");
         *ax = *ay = *az = 0.0f;
-        return;
+        return ret;
+    }
+
+    mpu6050_accel_t a;
+    decode_accel(data, &a);
+    *ax = a.x;
+    *ay = a.y;
+    *az = a.z;
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_read_motion(mpu6050_motion_t *out) {
+    uint8_t data[MPU6050_MOTION_FRAME];
+    esp_err_t ret = i2c_bus_read_bytes(MPU6050_ADDR, MPU6050_ACCEL_XOUT_H, data, sizeof(data));
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Motion read failed");
+        *out = (mpu6050_motion_t){0};
+        return ret;
     }
 
-    int16_t raw_x = (data[0] << 8) | data[1];
-    int16_t raw_y = (data[2] << 8) | data[3];
-    int16_t raw_z = (data[4] << 8) | data[5];
+    decode_motion(data, out);
+    return ESP_OK;
+}
+
+static esp_err_t fifo_reset(void) {
+    esp_err_t ret = i2c_bus_write_byte(MPU6050_ADDR, MPU6050_USER_CTRL, MPU6050_USER_CTRL_FIFO_RST);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return i2c_bus_write_byte(MPU6050_ADDR, MPU6050_USER_CTRL, MPU6050_USER_CTRL_FIFO_EN);
+}
 
-    *ax = raw_x / MPU6050_ACCEL_SCALE;
-    *ay = raw_y / MPU6050_ACCEL_SCALE;
-    *az = raw_z / MPU6050_ACCEL_SCALE;
+esp_err_t mpu6050_configure(const mpu6050_config_t *config, uint16_t *actual_rate_hz) {
+    uint32_t base = config->dlpf == MPU6050_DLPF_OFF ? MPU6050_BASE_RATE_NO_DLPF_HZ
+                                                     : MPU6050_BASE_RATE_HZ;
+    if (config->sample_rate_hz == 0 || config->sample_rate_hz > MPU6050_BASE_RATE_HZ ||
+        config->accel_range > MPU6050_RANGE_16G || config->dlpf > MPU6050_DLPF_5HZ) {
+        ESP_LOGE(TAG, "Unsupported configuration: %u Hz, range %d, dlpf %d",
+                 config->sample_rate_hz, config->accel_range, config->dlpf);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t div = (base + config->sample_rate_hz / 2) / config->sample_rate_hz - 1;
+    if (div > 255) {
+        div = 255;
+    }
+
+    esp_err_t ret = i2c_bus_write_byte(MPU6050_ADDR, MPU6050_CONFIG, (uint8_t)config->dlpf);
+    if (ret == ESP_OK) {
+        ret = i2c_bus_write_byte(MPU6050_ADDR, MPU6050_SMPLRT_DIV, (uint8_t)div);
+    }
+    if (ret == ESP_OK) {
+        ret = i2c_bus_write_byte(MPU6050_ADDR, MPU6050_ACCEL_CONFIG,
+                                 (uint8_t)(config->accel_range << MPU6050_ACCEL_CONFIG_AFS_SHIFT));
+    }
+    if (ret == ESP_OK && fifo_enabled) {
+        ret = fifo_reset();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure MPU6050: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    accel_scale = MPU6050_ACCEL_SCALE_2G / (float)(1 << config->accel_range);
+    *actual_rate_hz = (uint16_t)(base / (div + 1));
+    ESP_LOGI(TAG, "Sampling at %u Hz, +-%d g, dlpf %d", *actual_rate_hz,
+             2 << config->accel_range, config->dlpf);
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_fifo_init(bool with_gyro) {
+    uint8_t sources = MPU6050_FIFO_EN_ACCEL;
+    fifo_frame_size = MPU6050_FIFO_ACCEL_FRAME;
+    if (with_gyro) {
+        sources |= MPU6050_FIFO_EN_TEMP_GYRO;
+        fifo_frame_size = MPU6050_MOTION_FRAME;
+    }
+
+    esp_err_t ret = i2c_bus_write_byte(MPU6050_ADDR, MPU6050_FIFO_EN, sources);
+    if (ret == ESP_OK) {
+        ret = fifo_reset();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure FIFO: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    fifo_enabled = true;
+    ESP_LOGI(TAG, "FIFO enabled, %u byte frames", (unsigned)fifo_frame_size);
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_data_ready_init(void) {
+    // Active high, push-pull, 50 us pulse per sample; no status read needed
+    esp_err_t ret = i2c_bus_write_byte(MPU6050_ADDR, MPU6050_INT_PIN_CFG, 0x00);
+    if (ret == ESP_OK) {
+        ret = i2c_bus_write_byte(MPU6050_ADDR, MPU6050_INT_ENABLE, MPU6050_INT_DATA_RDY_EN);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure data ready interrupt: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Data ready interrupt enabled");
+    return ESP_OK;
+}
+
+// Bursts every complete frame in the FIFO, up to max_frames, into fifo_buf
+static esp_err_t fifo_read_frames(size_t max_frames, size_t *frames_out) {
+    *frames_out = 0;
+
+    uint8_t count_buf[2];
+    esp_err_t ret = i2c_bus_read_bytes(MPU6050_ADDR, MPU6050_FIFO_COUNT_H, count_buf, 2);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "FIFO count read failed");
+        return ret;
+    }
+
+    // Once full, the FIFO drops bytes rather than whole frames, so the frame
+    // boundaries are lost
+    size_t fifo_bytes = ((size_t)count_buf[0] << 8) | count_buf[1];
+    if (fifo_bytes >= MPU6050_FIFO_SIZE) {
+        ESP_LOGW(TAG, "FIFO overflow, resetting");
+        fifo_reset();
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t frames = fifo_bytes / fifo_frame_size;
+    if (frames > max_frames) {
+        frames = max_frames;
+    }
+    if (frames == 0) {
+        return ESP_OK;
+    }
+
+    ret = i2c_bus_read_bytes(MPU6050_ADDR, MPU6050_FIFO_R_W, fifo_buf, frames * fifo_frame_size);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "FIFO burst read failed");
+        return ret;
+    }
+
+    *frames_out = frames;
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_fifo_read_accel(mpu6050_accel_t *samples, size_t max_samples, size_t *count) {
+    esp_err_t ret = fifo_read_frames(max_samples, count);
+    for (size_t i = 0; i < *count; i++) {
+        decode_accel(&fifo_buf[i * fifo_frame_size], &samples[i]);
+    }
+    return ret;
+}
+
+esp_err_t mpu6050_fifo_read_motion(mpu6050_motion_t *samples, size_t max_samples, size_t *count) {
+    if (fifo_frame_size != MPU6050_MOTION_FRAME) {
+        *count = 0;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = fifo_read_frames(max_samples, count);
+    for (size_t i = 0; i < *count; i++) {
+        decode_motion(&fifo_buf[i * fifo_frame_size], &samples[i]);
+    }
+    return ret;
+}
+
+esp_err_t mpu6050_read_counts(mpu6050_counts_t *out, bool with_gyro) {
+    uint8_t data[MPU6050_MOTION_FRAME];
+    size_t len = with_gyro ? MPU6050_MOTION_FRAME : MPU6050_FIFO_ACCEL_FRAME;
+    esp_err_t ret = i2c_bus_read_bytes(MPU6050_ADDR, MPU6050_ACCEL_XOUT_H, data, len);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Counts read failed");
+        *out = (mpu6050_counts_t){0};
+        return ret;
+    }
+
+    decode_counts(data, with_gyro, out);
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_fifo_read_counts(mpu6050_counts_t *samples, size_t max_samples, size_t *count) {
+    esp_err_t ret = fifo_read_frames(max_samples, count);
+    bool motion = fifo_frame_size == MPU6050_MOTION_FRAME;
+    for (size_t i = 0; i < *count; i++) {
+        decode_counts(&fifo_buf[i * fifo_frame_size], motion, &samples[i]);
+    }
+    return ret;
 }
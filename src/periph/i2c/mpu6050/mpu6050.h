@@ -1,11 +1,120 @@
 #pragma once
 #include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #define MPU6050_ADDR            0x68
 #define MPU6050_PWR_MGMT_1      0x6B
 #define MPU6050_ACCEL_XOUT_H    0x3B
 #define MPU6050_ACCEL_CONFIG    0x1C
-#define MPU6050_ACCEL_SCALE     16384.0f
+#define MPU6050_ACCEL_SCALE_2G  16384.0f // LSB per g, halved for each wider range
+#define MPU6050_GYRO_CONFIG     0x1B
+#define MPU6050_GYRO_SCALE      131.0f   // LSB per deg/s at +-250 deg/s
+
+// Temperature in C = raw / 340 + 36.53
+#define MPU6050_TEMP_SCALE      340.0f
+#define MPU6050_TEMP_OFFSET     36.53f
+
+#define MPU6050_SMPLRT_DIV      0x19
+#define MPU6050_CONFIG          0x1A
+#define MPU6050_FIFO_EN         0x23
+#define MPU6050_INT_PIN_CFG     0x37
+#define MPU6050_INT_ENABLE      0x38
+#define MPU6050_USER_CTRL       0x6A
+#define MPU6050_FIFO_COUNT_H    0x72
+#define MPU6050_FIFO_R_W        0x74
+
+#define MPU6050_ACCEL_CONFIG_AFS_SHIFT 3
+#define MPU6050_FIFO_EN_ACCEL       0x08
+#define MPU6050_FIFO_EN_TEMP_GYRO   0xF0 // TEMP, XG, YG, ZG
+#define MPU6050_USER_CTRL_FIFO_EN   0x40
+#define MPU6050_USER_CTRL_FIFO_RST  0x04
+#define MPU6050_INT_DATA_RDY_EN     0x01
+
+#define MPU6050_FIFO_SIZE           1024
+#define MPU6050_FIFO_ACCEL_FRAME    6    // X, Y, Z as big-endian int16
+#define MPU6050_MOTION_FRAME        14   // Accel, temperature, gyro, in register order
+// Sample rate = base / (1 + SMPLRT_DIV). The base is the gyro output rate,
+// 1 kHz with the DLPF on and 8 kHz with it off; the accelerometer itself
+// never updates faster than 1 kHz.
+#define MPU6050_BASE_RATE_HZ        1000
+#define MPU6050_BASE_RATE_NO_DLPF_HZ 8000
+
+// ACCEL_CONFIG AFS_SEL
+typedef enum {
+    MPU6050_RANGE_2G,
+    MPU6050_RANGE_4G,
+    MPU6050_RANGE_8G,
+    MPU6050_RANGE_16G,
+} mpu6050_accel_range_t;
+
+// CONFIG DLPF_CFG, named by accelerometer bandwidth
+typedef enum {
+    MPU6050_DLPF_OFF, // 260 Hz
+    MPU6050_DLPF_184HZ,
+    MPU6050_DLPF_94HZ,
+    MPU6050_DLPF_44HZ,
+    MPU6050_DLPF_21HZ,
+    MPU6050_DLPF_10HZ,
+    MPU6050_DLPF_5HZ,
+} mpu6050_dlpf_t;
+
+typedef struct {
+    uint16_t sample_rate_hz;
+    mpu6050_accel_range_t accel_range;
+    mpu6050_dlpf_t dlpf;
+} mpu6050_config_t;
+
+typedef struct {
+    float x;
+    float y;
+    float z;
+} mpu6050_accel_t;
+
+typedef struct {
+    mpu6050_accel_t accel; // g
+    mpu6050_accel_t gyro;  // deg/s
+    float temp_c;
+} mpu6050_motion_t;
+
+// A frame as the chip's int16 counts, for callers that scale them without
+// floats. temp and gyro are only filled from motion frames.
+typedef struct {
+    int16_t accel[3];
+    int16_t temp;
+    int16_t gyro[3];
+} mpu6050_counts_t;
 
 esp_err_t mpu6050_init(void);
-void mpu6050_read_accel(float *ax, float *ay, float *az);
+// On error the axes are zeroed; they are not a reading
+esp_err_t mpu6050_read_accel(float *ax, float *ay, float *az);
+
+// Reads accelerometer, temperature and gyroscope in one 14-byte burst
+esp_err_t mpu6050_read_motion(mpu6050_motion_t *out);
+
+// Sets sample rate, accelerometer range and DLPF. The rate is rounded to the
+// nearest one the divider can produce and returned in *actual_rate_hz.
+// Readings decoded afterwards use the new range. Safe to call while sampling;
+// a running FIFO is reset so it holds no samples from the old settings.
+esp_err_t mpu6050_configure(const mpu6050_config_t *config, uint16_t *actual_rate_hz);
+
+// Samples the accelerometer into the on-chip FIFO at the configured rate.
+// With with_gyro, each frame also carries temperature and gyroscope.
+esp_err_t mpu6050_fifo_init(bool with_gyro);
+
+// Pulses the INT pin high once per sample at the configured rate. The caller
+// owns the GPIO and its ISR.
+esp_err_t mpu6050_data_ready_init(void);
+
+// Reads every complete sample in the FIFO, up to max_samples, in one burst.
+// On FIFO overflow the FIFO is reset, *count is 0 and ESP_ERR_INVALID_STATE
+// is returned.
+esp_err_t mpu6050_fifo_read_accel(mpu6050_accel_t *samples, size_t max_samples, size_t *count);
+
+// As mpu6050_fifo_read_accel, for a FIFO initialised with_gyro
+esp_err_t mpu6050_fifo_read_motion(mpu6050_motion_t *samples, size_t max_samples, size_t *count);
+
+// Undecoded counterparts of the reads above. with_gyro reads a motion frame.
+esp_err_t mpu6050_read_counts(mpu6050_counts_t *out, bool with_gyro);
+esp_err_t mpu6050_fifo_read_counts(mpu6050_counts_t *samples, size_t max_samples, size_t *count);
@@ -0,0 +1,191 @@
+#include "biquad.h"
+#include "config.h"
+#include <math.h>
+
+
+#if DETECTOR_FIXED_POINT
+#define COEFF(v) ((int32_t)lrintf((v) * (float)(1 << BIQUAD_COEFF_SHIFT)))
+#else
+#define COEFF(v) (v)
+#endif
+
+// RBJ cookbook low-pass section
+static biquad_coeffs_t lowpass_section(float cutoff_hz, float sample_rate_hz, float q)
+{
+    float w0 = 2.0f * (float)M_PI * cutoff_hz / sample_rate_hz;
+    float cos_w0 = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q);
+    float a0 = 1.0f + alpha;
+    float a1 = -2.0f * cos_w0 / a0;
+    float a2 = (1.0f - alpha) / a0;
+    // b0 + b1 + b2 = 1 + a1 + a2 from the rounded poles rather than from
+    // (1 - cos w0) / a0: at low cutoff/rate the two differ by 1e-4, which is
+    // a DC gain error on the 1 g axis
+    float b1 = (1.0f + a1 + a2) / 2.0f;
+    return (biquad_coeffs_t){
+        .b0 = COEFF(b1 / 2.0f),
+        .b1 = COEFF(b1),
+        .b2 = COEFF(b1 / 2.0f),
+        .a1 = COEFF(a1),
+        .a2 = COEFF(a2),
+    };
+}
+
+void biquad_design_lowpass(biquad_cascade_t *f, uint8_t stages, float cutoff_hz,
+                           float sample_rate_hz)
+{
+    if (stages > BIQUAD_MAX_STAGES)
+        stages = BIQUAD_MAX_STAGES;
+    f->stages = stages;
+    f->cutoff_hz = cutoff_hz;
+    f->sample_rate_hz = sample_rate_hz;
+    f->primed = false;
+
+    if (cutoff_hz <= 0.0f || cutoff_hz >= BIQUAD_NYQUIST_MARGIN * sample_rate_hz)
+    {
+        f->active_stages = 0;
+        return;
+    }
+
+    // Butterworth poles split into conjugate pairs, one pair per section
+    f->active_stages = stages;
+    for (uint8_t k = 0; k < stages; k++)
+    {
+        float q = 1.0f / (2.0f * cosf((float)M_PI * (2 * k + 1) / (4.0f * stages)));
+        f->coeffs[k] = lowpass_section(cutoff_hz, sample_rate_hz, q);
+    }
+}
+
+#if DETECTOR_FIXED_POINT
+// A low-pass settles on its input, so a constant v fills every history slot
+static void prime(biquad_cascade_t *f, const accel_t v[BIQUAD_AXES])
+{
+    for (int a = 0; a < BIQUAD_AXES; a++)
+    {
+        int32_t x = (int32_t)v[a] << BIQUAD_STATE_SHIFT;
+        for (uint8_t k = 0; k < f->active_stages; k++)
+        {
+            for (int i = 0; i < 4; i++)
+                f->state[k][a][i] = x;
+        }
+    }
+    f->primed = true;
+}
+
+void biquad_process(biquad_cascade_t *f, sensor_reading_t *r)
+{
+    if (f->active_stages == 0)
+        return;
+
+    accel_t in[BIQUAD_AXES] = {r->x, r->y, r->z};
+    if (!f->primed)
+        prime(f, in);
+
+    int32_t v[BIQUAD_AXES];
+    for (int a = 0; a < BIQUAD_AXES; a++)
+        v[a] = (int32_t)in[a] << BIQUAD_STATE_SHIFT;
+
+    for (uint8_t k = 0; k < f->active_stages; k++)
+    {
+        const biquad_coeffs_t c = f->coeffs[k];
+        for (int a = 0; a < BIQUAD_AXES; a++)
+        {
+            int32_t *s = f->state[k][a];
+            int32_t x = v[a];
+            int64_t acc = (int64_t)c.b0 * x + (int64_t)c.b1 * s[0] + (int64_t)c.b2 * s[1] -
+                          (int64_t)c.a1 * s[2] - (int64_t)c.a2 * s[3];
+            int32_t y = (int32_t)((acc + (1 << (BIQUAD_COEFF_SHIFT - 1))) >> BIQUAD_COEFF_SHIFT);
+            s[1] = s[0];
+            s[0] = x;
+            s[3] = s[2];
+            s[2] = y;
+            v[a] = y;
+        }
+    }
+
+    const int32_t half = 1 << (BIQUAD_STATE_SHIFT - 1);
+    r->x = accel_clamp((v[0] + half) >> BIQUAD_STATE_SHIFT);
+    r->y = accel_clamp((v[1] + half) >> BIQUAD_STATE_SHIFT);
+    r->z = accel_clamp((v[2] + half) >> BIQUAD_STATE_SHIFT);
+}
+#else
+// Sets every section's state to its steady state for a constant input v,
+// so the filter starts settled instead of ramping up from zero (1 g on z)
+static void prime(biquad_cascade_t *f, const float v[BIQUAD_AXES])
+{
+    for (int a = 0; a < BIQUAD_AXES; a++)
+    {
+        float x = v[a];
+        for (uint8_t k = 0; k < f->active_stages; k++)
+        {
+            const biquad_coeffs_t *c = &f->coeffs[k];
+            float y = x * (c->b0 + c->b1 + c->b2) / (1.0f + c->a1 + c->a2);
+            f->state[k][a][1] = c->b2 * x - c->a2 * y;
+            f->state[k][a][0] = c->b1 * x - c->a1 * y + f->state[k][a][1];
+            x = y;
+        }
+    }
+    f->primed = true;
+}
+
+void biquad_process(biquad_cascade_t *f, sensor_reading_t *r)
+{
+    if (f->active_stages == 0)
+        return;
+
+    float v[BIQUAD_AXES] = {r->x, r->y, r->z};
+    if (!f->primed)
+        prime(f, v);
+
+    for (uint8_t k = 0; k < f->active_stages; k++)
+    {
+        const biquad_coeffs_t c = f->coeffs[k];
+        for (int a = 0; a < BIQUAD_AXES; a++)
+        {
+            float *s = f->state[k][a];
+            float x = v[a];
+            float y = c.b0 * x + s[0];
+            s[0] = c.b1 * x - c.a1 * y + s[1];
+            s[1] = c.b2 * x - c.a2 * y;
+            v[a] = y;
+        }
+    }
+
+    r->x = v[0];
+    r->y = v[1];
+    r->z = v[2];
+}
+
+void biquad_process_block(biquad_cascade_t *f, float *const axis[BIQUAD_AXES], size_t count)
+{
+    if (f->active_stages == 0 || count == 0)
+        return;
+
+    if (!f->primed)
+    {
+        float first[BIQUAD_AXES] = {axis[0][0], axis[1][0], axis[2][0]};
+        prime(f, first);
+    }
+
+    for (uint8_t k = 0; k < f->active_stages; k++)
+    {
+        const biquad_coeffs_t c = f->coeffs[k];
+        for (int a = 0; a < BIQUAD_AXES; a++)
+        {
+            float *data = axis[a];
+            float s0 = f->state[k][a][0];
+            float s1 = f->state[k][a][1];
+            for (size_t i = 0; i < count; i++)
+            {
+                float x = data[i];
+                float y = c.b0 * x + s0;
+                s0 = c.b1 * x - c.a1 * y + s1;
+                s1 = c.b2 * x - c.a2 * y;
+                data[i] = y;
+            }
+            f->state[k][a][0] = s0;
+            f->state[k][a][1] = s1;
+        }
+    }
+}
+#endif
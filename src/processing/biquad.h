@@ -0,0 +1,66 @@
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "message_types.h"
+
+// Cascaded second-order IIR sections run on x, y and z independently, in
+// direct form II transposed: two state values per section per axis, and
+// better rounding behaviour in float than direct form I. Fixed-point builds
+// filter the Q10 readings in direct form I instead, whose integer sums
+// cannot overflow inside a section: Q28 coefficients, Q22 samples and state,
+// int64 products.
+
+#define BIQUAD_AXES 3
+#define BIQUAD_NYQUIST_MARGIN 0.45f // Of the sample rate; bilinear warping is extreme past it
+
+// Normalized so a0 is 1
+#if DETECTOR_FIXED_POINT
+#define BIQUAD_COEFF_SHIFT 28
+#define BIQUAD_STATE_SHIFT 12 // Fraction bits kept below the Q10 input
+typedef struct {
+    int32_t b0, b1, b2;
+    int32_t a1, a2;
+} biquad_coeffs_t;
+#else
+typedef struct {
+    float b0, b1, b2;
+    float a1, a2;
+} biquad_coeffs_t;
+#endif
+
+typedef struct {
+    // As last requested; redesign with these when the sample rate changes
+    uint8_t stages;
+    float cutoff_hz;
+    float sample_rate_hz;
+
+    uint8_t active_stages; // 0 passes samples through
+    bool primed;
+    biquad_coeffs_t coeffs[BIQUAD_MAX_STAGES];
+#if DETECTOR_FIXED_POINT
+    int32_t state[BIQUAD_MAX_STAGES][BIQUAD_AXES][4]; // x[n-1], x[n-2], y[n-1], y[n-2]
+#else
+    float state[BIQUAD_MAX_STAGES][BIQUAD_AXES][2];
+#endif
+} biquad_cascade_t;
+
+// Butterworth low-pass of order 2 * stages. A cutoff of 0, or one at
+// BIQUAD_NYQUIST_MARGIN of the rate or above, leaves the filter passing
+// samples through. Clears the
+// state; the next sample primes it as if that value had always been input.
+void biquad_design_lowpass(biquad_cascade_t *f, uint8_t stages, float cutoff_hz,
+                           float sample_rate_hz);
+
+// Filters x, y and z of one reading in place
+void biquad_process(biquad_cascade_t *f, sensor_reading_t *r);
+
+#if !DETECTOR_FIXED_POINT
+// Filters count samples of each axis in place, one section over the whole run
+// at a time so its coefficients and state stay in registers
+void biquad_process_block(biquad_cascade_t *f, float *const axis[BIQUAD_AXES], size_t count);
+#endif
+
+#endif // BIQUAD_H
@@ -0,0 +1,194 @@
+#include "decimator.h"
+#include "config.h"
+#include "esp_log.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "decimator";
+
+#define TAPS_MAX (DECIMATOR_TAPS_PER_PHASE * IMU_OVERSAMPLE_MAX)
+
+static uint8_t factor = 1;
+static uint16_t tap_count = 0;
+static float taps[TAPS_MAX];
+#if DETECTOR_FIXED_POINT
+// Accelerometer taps in Q15 for the Q10 readings. Their sum is 1 exactly,
+// and the sum of their magnitudes stays under 1.5, so a +-24 g input cannot
+// overflow the int32 accumulator.
+#define TAP_ONE (1 << 15)
+static int16_t accel_taps[TAPS_MAX];
+#endif
+
+// Each sample is written twice, tap_count apart, so the newest tap_count
+// samples are always contiguous and the filter needs no wraparound
+static accel_t accel_history[2 * TAPS_MAX][3];
+#if SENSOR_GYRO_ENABLED
+static float gyro_history[2 * TAPS_MAX][3];
+#endif
+static uint32_t timestamps[TAPS_MAX];
+static uint16_t head = 0;  // Next write
+static uint8_t phase = 0;  // Raw samples since the last output
+static bool primed = false;
+
+// Kaiser window and cutoff (of the output rate) for at least 60 dB from the
+// output Nyquist frequency up, flat to 0.2 dB through 0.2x the output rate.
+// host/decimator_response.c checks both.
+#define KAISER_BETA 6.0f
+#define CUTOFF 0.33f
+
+// Zeroth-order modified Bessel function, by its power series
+static float bessel_i0(float x)
+{
+    float term = 1.0f, sum = 1.0f;
+    for (int k = 1; k < 25; k++)
+    {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser-windowed sinc with unity DC gain
+void decimator_configure(uint8_t new_factor)
+{
+    factor = new_factor > IMU_OVERSAMPLE_MAX ? IMU_OVERSAMPLE_MAX : new_factor;
+    if (factor < 1)
+        factor = 1;
+    tap_count = DECIMATOR_TAPS_PER_PHASE * factor;
+
+    float cutoff = CUTOFF / factor; // Cycles per raw sample
+    float centre = (tap_count - 1) / 2.0f;
+    float i0_beta = bessel_i0(KAISER_BETA);
+    float sum = 0.0f;
+    for (uint16_t i = 0; i < tap_count; i++)
+    {
+        float t = i - centre;
+        float sinc = t == 0.0f ? 2.0f * cutoff
+                               : sinf(2.0f * (float)M_PI * cutoff * t) / ((float)M_PI * t);
+        float r = t / centre;
+        float window = bessel_i0(KAISER_BETA * sqrtf(1.0f - r * r)) / i0_beta;
+        taps[i] = sinc * window;
+        sum += taps[i];
+    }
+    for (uint16_t i = 0; i < tap_count; i++)
+        taps[i] /= sum;
+#if DETECTOR_FIXED_POINT
+    // Rounding error goes to the centre tap, so 1 g still comes out as 1 g
+    int32_t q_sum = 0;
+    for (uint16_t i = 0; i < tap_count; i++)
+    {
+        accel_taps[i] = (int16_t)lrintf(taps[i] * TAP_ONE);
+        q_sum += accel_taps[i];
+    }
+    accel_taps[tap_count / 2] += TAP_ONE - q_sum;
+#endif
+
+    head = 0;
+    phase = 0;
+    primed = false;
+    ESP_LOGI(TAG, "Decimating by %u with %u taps", factor, tap_count);
+}
+
+uint8_t decimator_get_factor(void)
+{
+    return factor;
+}
+
+static void store(const sensor_reading_t *r)
+{
+    const accel_t a[3] = {r->x, r->y, r->z};
+    memcpy(accel_history[head], a, sizeof(a));
+    memcpy(accel_history[head + tap_count], a, sizeof(a));
+#if SENSOR_GYRO_ENABLED
+    const float g[3] = {r->gx, r->gy, r->gz};
+    memcpy(gyro_history[head], g, sizeof(g));
+    memcpy(gyro_history[head + tap_count], g, sizeof(g));
+#endif
+    timestamps[head] = r->timestamp_us;
+    head = (head + 1) % tap_count;
+}
+
+// window runs oldest to newest
+static void filter_accel(const accel_t (*window)[3], accel_t out[3])
+{
+#if DETECTOR_FIXED_POINT
+    int32_t acc[3] = {TAP_ONE / 2, TAP_ONE / 2, TAP_ONE / 2}; // Rounds the Q15 result
+    for (uint16_t i = 0; i < tap_count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            acc[c] += accel_taps[i] * window[i][c];
+    }
+    for (int c = 0; c < 3; c++)
+        out[c] = accel_clamp(acc[c] >> 15);
+#else
+    float acc[3] = {0};
+    for (uint16_t i = 0; i < tap_count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            acc[c] += taps[i] * window[i][c];
+    }
+    memcpy(out, acc, sizeof(acc));
+#endif
+}
+
+#if SENSOR_GYRO_ENABLED
+static void filter_gyro(const float (*window)[3], float out[3])
+{
+    float acc[3] = {0};
+    for (uint16_t i = 0; i < tap_count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            acc[c] += taps[i] * window[i][c];
+    }
+    memcpy(out, acc, sizeof(acc));
+}
+#endif
+
+bool decimator_push(const sensor_reading_t *in, sensor_reading_t *out)
+{
+    if (factor == 1)
+    {
+        *out = *in;
+        return true;
+    }
+
+    // Start from a settled filter rather than ramping up from zero
+    if (!primed)
+    {
+        for (uint16_t i = 0; i < tap_count; i++)
+            store(in);
+        primed = true;
+    }
+    else
+    {
+        store(in);
+    }
+
+    if (++phase < factor)
+        return false;
+    phase = 0;
+
+    // history[head..head + tap_count) is the newest tap_count samples
+    accel_t accel[3];
+    filter_accel(&accel_history[head], accel);
+#if SENSOR_GYRO_ENABLED
+    float gyro[3];
+    filter_gyro(&gyro_history[head], gyro);
+#endif
+
+    // The filter delays by half its length; stamp the output with the raw
+    // sample at its centre
+    *out = (sensor_reading_t){
+        .x = accel[0],
+        .y = accel[1],
+        .z = accel[2],
+#if SENSOR_GYRO_ENABLED
+        .gx = gyro[0],
+        .gy = gyro[1],
+        .gz = gyro[2],
+#endif
+        .timestamp_us = timestamps[(head + tap_count / 2) % tap_count],
+        .accel_range_g = in->accel_range_g,
+    };
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "message_types.h"
+
+// Anti-alias FIR decimator from the raw IMU rate down to the sample rate.
+// Only the kept outputs are filtered, so the cost per raw sample is
+// DECIMATOR_TAPS_PER_PHASE multiply-adds per axis whatever the factor.
+
+// Designs the filter for factor (1 passes readings straight through) and
+// clears its history
+void decimator_configure(uint8_t factor);
+uint8_t decimator_get_factor(void);
+
+// Feeds one raw reading; true when it completes an output in *out
+bool decimator_push(const sensor_reading_t *in, sensor_reading_t *out);
+
+#endif // DECIMATOR_H
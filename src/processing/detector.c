@@ -1,42 +1,80 @@
 #include "detector.h"
 #include "detector_defs.h"
 #include "message_types.h"
-#include "queue/ring_buffer.h"
-#include "queue/ring_buffer_utils.h"
+#include "queue/priority_queue.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include "esp_log.h"
 
 static const char *TAG = "detector";
 
-static mqtt_message_t build_crash_message(float magnitude)
+static detector_thresholds_t thresholds;
+
+// Sample time with the wraps of the 32-bit timestamps counted, advanced on
+// every block so no wrap goes unseen
+static uint64_t clock_us;
+
+// A reading from the other stream may be a little older than the newest seen
+static uint64_t extend_timestamp(uint32_t timestamp_us)
+{
+    int32_t delta = (int32_t)(timestamp_us - (uint32_t)clock_us);
+    uint64_t us = clock_us + delta;
+    if (delta > 0) {
+        clock_us = us;
+    }
+    return us;
+}
+
+// Alerts stamp their first reading's sample time, in ticks like batches,
+// rather than when the block got here: FIFO bursts and sped-up replay would
+// move that
+static uint32_t sample_tick(uint32_t timestamp_us)
+{
+    return (uint32_t)(extend_timestamp(timestamp_us) * configTICK_RATE_HZ / 1000000);
+}
+
+static mqtt_message_t build_crash_message(const detector_episode_t *ep, uint32_t duration_ms)
 {
     return (mqtt_message_t){
         .type = MSG_CRASH,
         .data.crash = {
-            .timestamp = xTaskGetTickCount(),
-            .accel_magnitude = magnitude,
+            .timestamp = ep->start_tick,
+            .duration_ms = duration_ms,
+            .accel_magnitude = ep->peak,
         },
     };
 }
 
-static mqtt_message_t build_warning_message(warning_event_t event, const sensor_reading_t *data)
+static mqtt_message_t build_warning_message(warning_event_t event, const detector_episode_t *ep,
+                                            uint32_t duration_ms)
 {
     return (mqtt_message_t){
         .type = MSG_WARNING,
         .data.warning = {
             .event = event,
-            .timestamp = xTaskGetTickCount(),
-            .accel_x = data->x,
-            .accel_y = data->y,
+            .timestamp = ep->start_tick,
+            .duration_ms = duration_ms,
+            .peak = ep->peak,
+            .accel_x = ep->peak_x,
+            .accel_y = ep->peak_y,
         },
     };
 }
 
+// The kernels compare in signal units, so convert here rather than per block
+static void apply_threshold(detector_type_t type, float threshold_g)
+{
+    detector_config_t *det = &detectors[type];
+    det->threshold = threshold_g;
+    thresholds.enter[type] = severity_from_g(threshold_g, det->severity_squared);
+    thresholds.exit[type] = severity_from_g(threshold_g * DETECTOR_EXIT_RATIO,
+                                            det->severity_squared);
+}
+
 void detectors_init(void)
 {
     for (int i = 0; i < DETECTOR_COUNT; i++) {
-        detectors[i].threshold = detectors[i].default_threshold;
+        apply_threshold(i, detectors[i].default_threshold);
+        detectors[i].episode = (detector_episode_t){.state = EPISODE_IDLE};
     }
     ESP_LOGI(TAG, "Detectors initialized");
 }
@@ -44,7 +82,7 @@ void detectors_init(void)
 void detector_set_threshold(detector_type_t type, float threshold_g)
 {
     if (type >= DETECTOR_COUNT) return;
-    detectors[type].threshold = threshold_g;
+    apply_threshold(type, threshold_g);
     ESP_LOGI(TAG, "%s threshold set to %.2f g", detectors[type].name, threshold_g);
 }
 
@@ -60,40 +98,153 @@ const char *detector_get_name(detector_type_t type)
     return detectors[type].name;
 }
 
-static void handle_detection(detector_config_t *det, const sensor_reading_t *data)
+static void publish_episode(detector_config_t *det, uint32_t duration_ms)
 {
-    float value = det->get_value(data);
-
+    const detector_episode_t *ep = &det->episode;
     mqtt_message_t msg = det->is_crash
-        ? build_crash_message(value)
-        : build_warning_message(det->warning_event, data);
+        ? build_crash_message(ep, duration_ms)
+        : build_warning_message(det->warning_event, ep, duration_ms);
 
-    bool success = false;
-    if (det->is_crash) {
-        // High priority - send immediately
-        success = ring_buffer_push_front(mqtt_rb, &msg, NULL);
-    } else {
-        success = ring_buffer_push_back_with_full_log(mqtt_rb, &msg,
-                                                      "mqtt_rb full, overwrote oldest alert");
+    // Crashes have their own lane, so warnings can never evict them
+    mqtt_lane_t lane = det->is_crash ? MQTT_LANE_CRASH : MQTT_LANE_WARNING;
+    bool dropped = false;
+    bool success = priority_queue_push(mqtt_rb, lane, &msg, &dropped);
+
+    if (success && dropped) {
+        ESP_LOGW(TAG, "mqtt_rb %s lane full, overwrote oldest alert", det->name);
     }
 
     if (!success) {
         ESP_LOGW(TAG, "mqtt_rb: failed to push %s alert", det->name);
     } else {
-        ESP_LOGI(TAG, "%s detected! Value: %.2f g", det->name, value);
+        ESP_LOGI(TAG, "%s detected! Peak: %.2f g over %lu ms", det->name, ep->peak,
+                 (unsigned long)duration_ms);
+    }
+}
+
+// The display hears about an episode as soon as it has lasted long enough.
+// So does the server for a crash: its alert cannot wait for the episode to
+// end, and carries the duration and peak so far.
+static void confirm_episode(detector_config_t *det, uint32_t now_us)
+{
+    det->episode.confirmed = true;
+    detector_notify(det - detectors);
+    if (det->is_crash) {
+        publish_episode(det, (now_us - det->episode.start_us) / 1000);
+    }
+}
+
+static void end_episode(detector_config_t *det, uint32_t end_us)
+{
+    detector_episode_t *ep = &det->episode;
+    uint32_t duration_ms = (end_us - ep->start_us) / 1000; // Wrap-safe
+
+    if (!ep->confirmed && duration_ms >= det->min_duration_ms) {
+        confirm_episode(det, end_us);
+    }
+    if (!ep->confirmed) {
+        ep->state = EPISODE_IDLE; // Too short to count
+        return;
     }
 
-    if (det->on_trigger) {
-        det->on_trigger(det->display_name);
+    if (!det->is_crash) {
+        publish_episode(det, duration_ms);
     }
+    ep->state = EPISODE_REFRACTORY;
+    ep->last_us = end_us;
 }
 
-void detectors_check_all(const sensor_reading_t *data)
+static void track_peak(detector_config_t *det, const sensor_block_t *block, size_t i,
+                       severity_t severity)
 {
+    detector_episode_t *ep = &det->episode;
+    if (severity > ep->peak_severity) {
+        ep->peak_severity = severity;
+        ep->peak = detector_value(det - detectors, block, i);
+        ep->peak_x = block_value_to_g(block->x[i]);
+        ep->peak_y = block_value_to_g(block->y[i]);
+    }
+}
+
+// Idle -> active above the threshold; active until below threshold *
+// DETECTOR_EXIT_RATIO, then reported if it lasted min_duration_ms; quiet
+// for refractory_ms after that
+static void update_episode(detector_config_t *det, const sensor_block_t *block, size_t i,
+                           severity_t severity, bool entered, bool stayed)
+{
+    detector_episode_t *ep = &det->episode;
+    uint32_t now = block->timestamp_us[i];
+
+    switch (ep->state) {
+    case EPISODE_REFRACTORY:
+        if (now - ep->last_us < (uint32_t)det->refractory_ms * 1000) {
+            return;
+        }
+        ep->state = EPISODE_IDLE;
+        // Fall through
+    case EPISODE_IDLE:
+        if (!entered) {
+            return;
+        }
+        *ep = (detector_episode_t){
+            .state = EPISODE_ACTIVE,
+            .start_us = now,
+            .last_us = now,
+            .start_tick = sample_tick(now),
+            .peak_severity = DETECTOR_SEVERITY_MIN,
+        };
+        track_peak(det, block, i, severity);
+        break;
+    case EPISODE_ACTIVE:
+        if (!stayed) {
+            end_episode(det, now);
+            return;
+        }
+        ep->last_us = now;
+        track_peak(det, block, i, severity);
+        break;
+    }
+
+    if (!ep->confirmed && now - ep->start_us >= (uint32_t)det->min_duration_ms * 1000) {
+        confirm_episode(det, now);
+    }
+    if (now - ep->start_us >= (uint32_t)DETECTOR_MAX_EPISODE_MS * 1000) {
+        end_episode(det, now);
+    }
+}
+
+// The state machine only runs where something happens: a quiet block with
+// no episode open costs nothing past the shared evaluation pass
+static uint32_t run_detector(detector_type_t type, const sensor_block_t *block,
+                             const detector_block_result_t *result)
+{
+    detector_config_t *det = &detectors[type];
+    uint32_t entered = result->entered[type];
+    if (entered == 0 && det->episode.state != EPISODE_ACTIVE) {
+        return 0;
+    }
+
+    uint32_t stayed = result->stayed[type];
+    for (size_t i = 0; i < block->count; i++) {
+        update_episode(det, block, i, result->severity[type][i], entered >> i & 1,
+                       stayed >> i & 1);
+    }
+    return entered;
+}
+
+uint32_t detectors_check_block(const sensor_block_t *block, detector_stream_t stream)
+{
+    static detector_block_result_t result;
+    detector_evaluate_block(block, stream, &thresholds, &result);
+    if (block->count > 0) {
+        extend_timestamp(block->timestamp_us[block->count - 1]);
+    }
+
+    uint32_t triggered = 0;
     for (int i = 0; i < DETECTOR_COUNT; i++) {
-        detector_config_t *det = &detectors[i];
-        if (det->check(data, det->threshold)) {
-            handle_detection(det, data);
+        if (detectors[i].stream == stream) {
+            triggered |= run_detector(i, block, &result);
         }
     }
+    return triggered;
 }
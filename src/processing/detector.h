@@ -2,20 +2,32 @@
 #define DETECTOR_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "message_types.h"
+#include "detector_list.h"
+
+typedef struct sensor_block sensor_block_t;
 
 typedef enum {
-    DETECTOR_CRASH,
-    DETECTOR_HARSH_BRAKING,
-    DETECTOR_HARSH_ACCEL,
-    DETECTOR_HARSH_CORNERING,
+#define X(id, ...) DETECTOR_##id,
+    DETECTOR_LIST(X)
+#undef X
     DETECTOR_COUNT
 } detector_type_t;
 
+// Readings a detector sees: raw IMU rate, or sample rate after the
+// anti-alias filter. The same stream unless oversampling.
+typedef enum {
+    DETECTOR_STREAM_FULL,
+    DETECTOR_STREAM_DECIMATED
+} detector_stream_t;
+
 void detectors_init(void);
 void detector_set_threshold(detector_type_t type, float threshold_g);
 float detector_get_threshold(detector_type_t type);
-void detectors_check_all(const sensor_reading_t *data);
+// Runs the detectors that take readings from stream over a block, in order.
+// Returns a mask of the samples where any of them crossed its threshold.
+uint32_t detectors_check_block(const sensor_block_t *block, detector_stream_t stream);
 const char *detector_get_name(detector_type_t type);
 
 #endif // DETECTOR_H
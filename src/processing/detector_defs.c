@@ -1,94 +1,53 @@
 #include "detector_defs.h"
 #include "config.h"
 #include "display/display_manager.hpp"
-#include <math.h>
 
-#define GRAVITY_G 1.0f
-
-static float calculate_dynamic_magnitude(const sensor_reading_t *data)
-{
-    float z_dynamic = data->z - GRAVITY_G;
-    return sqrtf(data->x * data->x + data->y * data->y + z_dynamic * z_dynamic);
-}
-
-static bool check_crash(const sensor_reading_t *data, float threshold)
-{
-    return calculate_dynamic_magnitude(data) >= threshold;
-}
-
-static bool check_harsh_braking(const sensor_reading_t *data, float threshold)
-{
-    return data->y <= -threshold;
-}
-
-static bool check_harsh_accel(const sensor_reading_t *data, float threshold)
-{
-    return data->y >= threshold;
-}
-
-static bool check_harsh_cornering(const sensor_reading_t *data, float threshold)
-{
-    return fabsf(data->x) >= threshold;
-}
-
-static float get_crash_value(const sensor_reading_t *data)
-{
-    return calculate_dynamic_magnitude(data);
-}
-
-static float get_braking_value(const sensor_reading_t *data)
-{
-    return data->y;
-}
-
-static float get_accel_value(const sensor_reading_t *data)
-{
-    return data->y;
-}
-
-static float get_cornering_value(const sensor_reading_t *data)
-{
-    return data->x;
-}
+#define IS_CRASH_CRASH true
+#define IS_CRASH_WARNING false
+#define EVENT_CRASH(id) 0 // Unused; crashes publish crash_data_t
+#define EVENT_WARNING(id) WARNING_##id
 
 detector_config_t detectors[DETECTOR_COUNT] = {
-    [DETECTOR_CRASH] = {
-        .name = "crash",
-        .display_name = "Crash Detected",
-        .default_threshold = DEFAULT_CRASH_THRESHOLD_G,
-        .is_crash = true,
-        .check = check_crash,
-        .get_value = get_crash_value,
-        .on_trigger = triggerWarningCountdown,
-    },
-    [DETECTOR_HARSH_BRAKING] = {
-        .name = "harsh_braking",
-        .display_name = "Harsh Braking",
-        .default_threshold = DEFAULT_HARSH_BRAKING_THRESHOLD_G,
-        .is_crash = false,
-        .warning_event = WARNING_HARSH_BRAKING,
-        .check = check_harsh_braking,
-        .get_value = get_braking_value,
-        .on_trigger = triggerNormalWarning,
-    },
-    [DETECTOR_HARSH_ACCEL] = {
-        .name = "harsh_accel",
-        .display_name = "Harsh Acceleration",
-        .default_threshold = DEFAULT_HARSH_ACCEL_THRESHOLD_G,
-        .is_crash = false,
-        .warning_event = WARNING_HARSH_ACCEL,
-        .check = check_harsh_accel,
-        .get_value = get_accel_value,
-        .on_trigger = triggerNormalWarning,
-    },
-    [DETECTOR_HARSH_CORNERING] = {
-        .name = "harsh_cornering",
-        .display_name = "Sharp Turn",
-        .default_threshold = DEFAULT_HARSH_CORNERING_THRESHOLD_G,
-        .is_crash = false,
-        .warning_event = WARNING_HARSH_CORNERING,
-        .check = check_harsh_cornering,
-        .get_value = get_cornering_value,
-        .on_trigger = triggerNormalWarning,
+#define X(id, detector_name, kind, signal, strm, min_ms, refract_ms, display, on_trigger, ...) \
+    [DETECTOR_##id] = {                                                               \
+        .name = detector_name,                                                        \
+        .display_name = display,                                                      \
+        .default_threshold = DEFAULT_##id##_THRESHOLD_G,                              \
+        .is_crash = IS_CRASH_##kind,                                                  \
+        .stream = DETECTOR_STREAM_##strm,                                             \
+        .min_duration_ms = min_ms,                                                    \
+        .refractory_ms = refract_ms,                                                  \
+        .warning_event = EVENT_##kind(id),                                            \
+        .severity_squared = SIGNAL_SQUARED_##signal,                                  \
     },
+    DETECTOR_LIST(X)
+#undef X
 };
+
+// Only called for samples inside an episode
+float detector_value(detector_type_t type, const sensor_block_t *block, size_t i)
+{
+    switch (type) {
+#define X(id, name, kind, signal, ...) \
+    case DETECTOR_##id:                \
+        return SIGNAL_VALUE_##signal(block, i);
+    DETECTOR_LIST(X)
+#undef X
+    default:
+        return 0.0f;
+    }
+}
+
+void detector_notify(detector_type_t type)
+{
+    switch (type) {
+#define X(id, name, kind, signal, strm, min_ms, refract_ms, display, on_trigger, ...) \
+    case DETECTOR_##id:                                                      \
+        on_trigger(display);                                                 \
+        break;
+    DETECTOR_LIST(X)
+#undef X
+    default:
+        break;
+    }
+}
@@ -3,20 +3,47 @@
 
 #include <stdbool.h>
 #include "detector.h"
+#include "detector_kernels.h"
 #include "message_types.h"
 
+typedef enum {
+    EPISODE_IDLE,
+    EPISODE_ACTIVE,     // Above the exit threshold since start_us
+    EPISODE_REFRACTORY, // Reported; ignoring new ones until refractory_ms passes
+} episode_state_t;
+
+// One excursion past the threshold, tracked on sample timestamps
+typedef struct {
+    episode_state_t state;
+    bool confirmed; // Lasted min_duration_ms; the display has been told
+    uint32_t start_us;
+    uint32_t last_us; // Latest sample in the episode, or its end once reported
+    uint32_t start_tick;
+    float peak;
+    severity_t peak_severity;
+    float peak_x;
+    float peak_y;
+} detector_episode_t;
+
 typedef struct {
     const char *name;
     const char *display_name;
     float default_threshold;
     float threshold;
     bool is_crash;
+    detector_stream_t stream;
+    uint16_t min_duration_ms; // Shorter episodes are dropped as glitches
+    uint16_t refractory_ms;   // Quiet time after a reported episode
     warning_event_t warning_event;
-    bool (*check)(const sensor_reading_t *data, float threshold);
-    float (*get_value)(const sensor_reading_t *data);
-    void (*on_trigger)(const char *message);
+    bool severity_squared; // Signal is compared to threshold squared
+    detector_episode_t episode;
 } detector_config_t;
 
 extern detector_config_t detectors[DETECTOR_COUNT];
 
+// Value reported for sample i of block, in g
+float detector_value(detector_type_t type, const sensor_block_t *block, size_t i);
+// Tells the display about a confirmed episode
+void detector_notify(detector_type_t type);
+
 #endif // DETECTOR_DEFS_H
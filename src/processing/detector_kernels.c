@@ -0,0 +1,45 @@
+#include "detector_kernels.h"
+#include <math.h>
+#include <string.h>
+
+float detector_block_magnitude(const sensor_block_t *block, size_t i)
+{
+    signal_terms_t t = signal_terms(block->x[i], block->y[i], block->z[i]);
+    return sqrtf((float)t.magnitude_sq) / DETECTOR_ONE_G;
+}
+
+// DETECTOR_LIST expands inline, so each term is computed once per sample
+// however many detectors use it, and with stream a constant the checks for
+// detectors on the other stream, and terms only they need, fold away
+static inline __attribute__((always_inline)) void evaluate(const sensor_block_t *block,
+                                                           detector_stream_t stream,
+                                                           const detector_thresholds_t *th,
+                                                           detector_block_result_t *out)
+{
+    memset(out->entered, 0, sizeof(out->entered));
+    memset(out->stayed, 0, sizeof(out->stayed));
+
+    for (size_t i = 0; i < block->count; i++) {
+        signal_terms_t t = signal_terms(block->x[i], block->y[i], block->z[i]);
+#define X(id, name, kind, signal, strm, ...)                                            \
+        if (DETECTOR_STREAM_##strm == stream) {                                         \
+            severity_t s = SIGNAL_##signal(t);                                          \
+            out->severity[DETECTOR_##id][i] = s;                                        \
+            out->entered[DETECTOR_##id] |= (uint32_t)(s >= th->enter[DETECTOR_##id]) << i; \
+            out->stayed[DETECTOR_##id] |= (uint32_t)(s >= th->exit[DETECTOR_##id]) << i;   \
+        }
+        DETECTOR_LIST(X)
+#undef X
+    }
+}
+
+void detector_evaluate_block(const sensor_block_t *block, detector_stream_t stream,
+                             const detector_thresholds_t *thresholds,
+                             detector_block_result_t *out)
+{
+    if (stream == DETECTOR_STREAM_FULL) {
+        evaluate(block, DETECTOR_STREAM_FULL, thresholds, out);
+    } else {
+        evaluate(block, DETECTOR_STREAM_DECIMATED, thresholds, out);
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef DETECTOR_KERNELS_H
+#define DETECTOR_KERNELS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include "message_types.h"
+#include "detector.h"
+
+// Detectors run over blocks of readings laid out one array per axis, in one
+// loop generated from DETECTOR_LIST that the compiler can inline and unroll.
+// No FreeRTOS or ESP-IDF dependencies. config.h still wants a
+// config_local.h, so host builds go through host/, which supplies its own.
+
+#define DETECTOR_BLOCK_SIZE 32 // One bit per sample in a uint32_t mask
+
+// Block values are readings' accel_t: Q10 int16 counts with
+// DETECTOR_FIXED_POINT, g otherwise
+#define DETECTOR_ONE_G ACCEL_ONE_G
+#if DETECTOR_FIXED_POINT
+#define DETECTOR_SEVERITY_MIN INT32_MIN
+typedef int32_t severity_t;
+#else
+#define DETECTOR_SEVERITY_MIN (-INFINITY)
+typedef float severity_t;
+#endif
+typedef accel_t block_value_t;
+
+static inline block_value_t block_value_from_g(float g)
+{
+    return accel_from_g(g);
+}
+
+static inline float block_value_to_g(block_value_t v)
+{
+    return accel_to_g(v);
+}
+
+// Thresholds are converted once, when they are set
+static inline severity_t severity_from_g(float g, bool squared)
+{
+    severity_t s = block_value_from_g(g);
+    return squared ? s * s : s;
+}
+
+struct sensor_block {
+    block_value_t x[DETECTOR_BLOCK_SIZE];
+    block_value_t y[DETECTOR_BLOCK_SIZE];
+    block_value_t z[DETECTOR_BLOCK_SIZE];
+    uint32_t timestamp_us[DETECTOR_BLOCK_SIZE];
+    size_t count;
+};
+
+// Appends a reading, already in block units; true once the block is full
+static inline bool sensor_block_append(sensor_block_t *block, const sensor_reading_t *r)
+{
+    size_t i = block->count++;
+    block->x[i] = r->x;
+    block->y[i] = r->y;
+    block->z[i] = r->z;
+    block->timestamp_us[i] = r->timestamp_us;
+    return block->count == DETECTOR_BLOCK_SIZE;
+}
+
+// Per-sample terms the signals are built from
+typedef struct {
+    severity_t y;
+    severity_t lateral;      // |x|
+    severity_t magnitude_sq; // Dynamic, gravity removed from z
+} signal_terms_t;
+
+static inline signal_terms_t signal_terms(block_value_t x, block_value_t y, block_value_t z)
+{
+    severity_t z_dynamic = (severity_t)z - DETECTOR_ONE_G;
+    return (signal_terms_t){
+        .y = y,
+        .lateral = x < 0 ? -x : x,
+        .magnitude_sq = (severity_t)x * x + (severity_t)y * y + z_dynamic * z_dynamic,
+    };
+}
+
+// What a detector thresholds (SIGNAL_<signal>), whether that is squared so
+// the threshold must be too, and the value reported for it in g
+#define SIGNAL_MAGNITUDE(t) ((t).magnitude_sq)
+#define SIGNAL_SQUARED_MAGNITUDE true
+#define SIGNAL_VALUE_MAGNITUDE(block, i) detector_block_magnitude(block, i)
+
+#define SIGNAL_BRAKING(t) (-(t).y)
+#define SIGNAL_SQUARED_BRAKING false
+#define SIGNAL_VALUE_BRAKING(block, i) block_value_to_g((block)->y[i])
+
+#define SIGNAL_ACCEL(t) ((t).y)
+#define SIGNAL_SQUARED_ACCEL false
+#define SIGNAL_VALUE_ACCEL(block, i) block_value_to_g((block)->y[i])
+
+#define SIGNAL_LATERAL(t) ((t).lateral)
+#define SIGNAL_SQUARED_LATERAL false
+#define SIGNAL_VALUE_LATERAL(block, i) block_value_to_g((block)->x[i])
+
+float detector_block_magnitude(const sensor_block_t *block, size_t i);
+
+// Thresholds in signal units, one per detector
+typedef struct {
+    severity_t enter[DETECTOR_COUNT];
+    severity_t exit[DETECTOR_COUNT];
+} detector_thresholds_t;
+
+typedef struct {
+    severity_t severity[DETECTOR_COUNT][DETECTOR_BLOCK_SIZE];
+    uint32_t entered[DETECTOR_COUNT]; // Bit i set where sample i reached enter
+    uint32_t stayed[DETECTOR_COUNT];  // Likewise for exit
+} detector_block_result_t;
+
+// Every detector on stream over the block in a single pass. Detectors on
+// other streams are left with empty masks.
+void detector_evaluate_block(const sensor_block_t *block, detector_stream_t stream,
+                             const detector_thresholds_t *thresholds,
+                             detector_block_result_t *out);
+
+#endif // DETECTOR_KERNELS_H
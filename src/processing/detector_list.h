@@ -0,0 +1,33 @@
+#ifndef DETECTOR_LIST_H
+#define DETECTOR_LIST_H
+
+// Every detector, one line each. The enums, the config table, the fused
+// block evaluation, the alert and status messages and set_threshold parsing
+// are all generated from this list, so adding a detector is one line here
+// plus its DEFAULT_<id>_THRESHOLD_G in config.h. A new signal also needs its
+// SIGNAL_* macros in detector_kernels.h.
+//
+//   id            DETECTOR_<id> and THRESHOLD_<id>, and WARNING_<id> for
+//                 WARNING detectors
+//   name          Log name, and the event name in warning alerts
+//   kind          CRASH or WARNING: which alert it publishes
+//   signal        SIGNAL_<signal> from detector_kernels.h
+//   stream        FULL or DECIMATED, see detector_stream_t
+//   min_ms        Shorter episodes are dropped as glitches
+//   refract_ms    Quiet time after a reported episode
+//   display_name  Shown by on_trigger
+//   on_trigger    Display call when an episode is confirmed
+//   setting       set_threshold type and status field for its threshold
+//
+// Crash runs on the full stream since impacts can be over within one output
+// period, and its refractory time covers the warning countdown. Cornering
+// needs longer than the rest because lane changes are brief; real corners
+// are not.
+#define DETECTOR_LIST(X)                                                                          \
+    /* id               name               kind     signal     stream     min_ms refract_ms display_name          on_trigger               setting */ \
+    X(CRASH,            "crash",           CRASH,   MAGNITUDE, FULL,      5,     5000,      "Crash Detected",     triggerWarningCountdown, "crash")     \
+    X(HARSH_BRAKING,    "harsh_braking",   WARNING, BRAKING,   DECIMATED, 150,   2000,      "Harsh Braking",      triggerNormalWarning,    "braking")   \
+    X(HARSH_ACCEL,      "harsh_accel",     WARNING, ACCEL,     DECIMATED, 150,   2000,      "Harsh Acceleration", triggerNormalWarning,    "accel")     \
+    X(HARSH_CORNERING,  "harsh_cornering", WARNING, LATERAL,   DECIMATED, 300,   2000,      "Sharp Turn",         triggerNormalWarning,    "cornering")
+
+#endif // DETECTOR_LIST_H
@@ -1,18 +1,43 @@
 #include "message_types.h"
 #include "queue/ring_buffer.h"
-#include "queue/ring_buffer_utils.h"
+#include "queue/priority_queue.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "trace/trace.h"
 #include "watchdog/watchdog.h"
 #include "detector.h"
+#include "detector_kernels.h"
+#include "decimator.h"
+#include "biquad.h"
+#include "sensor/sensor.h"
+#include "sensor/calibration.h"
+#include <math.h>
 
 static const char *TAG = "process";
 
-static sensor_batch_t current_batch;
+// Wake up at least this often with no data, to keep feeding the watchdog
+#define IDLE_WAKEUP_MS 1000
+
+// Filled in place inside batch_rb, committed once LOG_BATCH_SIZE samples are in
+static sensor_batch_t *current_batch = NULL;
 static uint16_t batch_index = 0;
+static uint16_t batch_accel_lsb_per_g = 0; // current_batch's, as an integer
+
+// Detector input for each stream: readings go through the stream's low-pass
+// filter into a block, one array per axis
+typedef struct {
+    detector_stream_t stream;
+    biquad_cascade_t filter;
+    sensor_block_t block;
+} detector_input_t;
+
+static detector_input_t full_input = {.stream = DETECTOR_STREAM_FULL};
+static detector_input_t decimated_input = {.stream = DETECTOR_STREAM_DECIMATED};
 
+static void update_filters(void);
+static void add_reading(detector_input_t *input, const sensor_reading_t *r);
+static void flush_block(detector_input_t *input);
 static void batch_telemetry_reading(const sensor_reading_t *data);
 static void handle_mqtt_command(const mqtt_command_t *cmd);
 static void send_status_response(void);
@@ -20,77 +45,285 @@ static void send_status_response(void);
 void processing_task(void *pvParameters)
 {
     (void)pvParameters;
-    sensor_reading_t sensor_data;
-    mqtt_command_t mqtt_cmd;
+    static sensor_reading_t readings[SENSOR_QUEUE_SIZE]; // Too big for the stack at high MOCK_SPEED
+    mqtt_command_t commands[COMMAND_QUEUE_SIZE];
+    size_t count;
 
-    current_batch.sample_rate_hz = IMU_SAMPLE_RATE_HZ;
-    current_batch.sample_count = 0;
     batch_index = 0;
 
     detectors_init();
+    biquad_design_lowpass(&full_input.filter, DETECTOR_FILTER_STAGES,
+                          DETECTOR_FILTER_FULL_CUTOFF_HZ, 0.0f);
+    biquad_design_lowpass(&decimated_input.filter, DETECTOR_FILTER_STAGES,
+                          DETECTOR_FILTER_DECIMATED_CUTOFF_HZ, 0.0f);
+
+    ring_buffer_set_consumer(sensor_rb, xTaskGetCurrentTaskHandle(), NOTIFY_SENSOR_DATA);
+    ring_buffer_set_consumer(mqtt_command_queue, xTaskGetCurrentTaskHandle(), NOTIFY_COMMAND);
 
     ESP_LOGI(TAG, "Processing task started");
     watchdog_register_task();
 
+    // Anything queued before we registered has not notified us
+    uint32_t pending = NOTIFY_SENSOR_DATA | NOTIFY_COMMAND;
+
     while (1)
     {
         TRACE_TASK_RUN(TAG);
         watchdog_feed();
 
-        while (ring_buffer_pop_front(mqtt_command_queue, &mqtt_cmd))
+        if (pending & NOTIFY_COMMAND)
         {
-            handle_mqtt_command(&mqtt_cmd);
+            while ((count = ring_buffer_pop_front_n(mqtt_command_queue, commands,
+                                                    COMMAND_QUEUE_SIZE)) > 0)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    handle_mqtt_command(&commands[i]);
+                }
+            }
         }
 
-        if (ring_buffer_pop_front(sensor_rb, &sensor_data))
+        if (pending & NOTIFY_SENSOR_DATA)
         {
-            detectors_check_all(&sensor_data);
-            batch_telemetry_reading(&sensor_data);
-        }
-        else
-        {
-            vTaskDelay(pdMS_TO_TICKS(10));
+            uint8_t oversample = sensor_get_oversample();
+            if (oversample != decimator_get_factor())
+                decimator_configure(oversample);
+            update_filters();
+
+            // Drain whatever has built up in one go; detectors take it in
+            // blocks, flushed at the end so nothing waits for the next drain
+            count = ring_buffer_pop_front_n(sensor_rb, readings, SENSOR_QUEUE_SIZE);
+            for (size_t i = 0; i < count; i++)
+            {
+                sensor_reading_t decimated;
+                add_reading(&full_input, &readings[i]);
+                if (decimator_push(&readings[i], &decimated))
+                {
+                    add_reading(&decimated_input, &decimated);
+                    batch_telemetry_reading(&decimated); // Unfiltered
+                }
+            }
+            flush_block(&full_input);
+            flush_block(&decimated_input);
         }
+
+        // Block until a producer pushes; bits set meanwhile are latched
+        pending = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &pending, pdMS_TO_TICKS(IDLE_WAKEUP_MS));
+    }
+}
+
+static void design_filter(detector_input_t *input, uint8_t stages, float cutoff_hz,
+                          float sample_rate_hz)
+{
+    biquad_cascade_t *f = &input->filter;
+    const char *name = input->stream == DETECTOR_STREAM_FULL ? "Full" : "Decimated";
+
+    flush_block(input); // Filtered with the old coefficients in block mode
+    biquad_design_lowpass(f, stages, cutoff_hz, sample_rate_hz);
+    if (f->active_stages > 0)
+        ESP_LOGI(TAG, "%s detector filter: order %u low-pass at %.1f Hz, %.0f Hz in", name,
+                 2 * f->active_stages, cutoff_hz, sample_rate_hz);
+    else
+        ESP_LOGI(TAG, "%s detector filter: off", name);
+}
+
+// Filter coefficients depend on the stream's rate; redesign when it changes
+static void update_filter(detector_input_t *input, float sample_rate_hz)
+{
+    biquad_cascade_t *f = &input->filter;
+    if (f->sample_rate_hz != sample_rate_hz)
+        design_filter(input, f->stages, f->cutoff_hz, sample_rate_hz);
+}
+
+static void update_filters(void)
+{
+    float rate = sensor_get_sample_rate_hz();
+    update_filter(&full_input, rate * decimator_get_factor());
+    update_filter(&decimated_input, rate);
+}
+
+// Per-reading filtering runs as readings go into the block, block filtering
+// on the whole block as it is flushed
+static void add_reading(detector_input_t *input, const sensor_reading_t *r)
+{
+#if DETECTOR_FILTER_BLOCK
+    bool full = sensor_block_append(&input->block, r);
+#else
+    sensor_reading_t filtered = *r;
+    biquad_process(&input->filter, &filtered);
+    bool full = sensor_block_append(&input->block, &filtered);
+#endif
+    if (full)
+        flush_block(input);
+}
+
+static void flush_block(detector_input_t *input)
+{
+    sensor_block_t *block = &input->block;
+    if (block->count == 0)
+        return;
+#if DETECTOR_FILTER_BLOCK
+    biquad_process_block(&input->filter, (float *const[]){block->x, block->y, block->z},
+                         block->count);
+#endif
+    detectors_check_block(block, input->stream);
+    block->count = 0;
+}
+
+static bool start_batch(uint16_t accel_lsb_per_g)
+{
+    // batch_rb drops new batches while the uplink is down. Every reading
+    // retries, so telemetry resumes as soon as a batch is sent, but during an
+    // outage only the free-space check runs: a failed reservation bumps
+    // stats.rejected, which then counts outages rather than readings. Only
+    // the outage's start and end are logged.
+    static bool dropping = false;
+
+    if (dropping && ring_buffer_is_full(batch_rb))
+        return false;
+
+    current_batch = ring_buffer_reserve_back(batch_rb, NULL);
+    if (!current_batch)
+    {
+        ESP_LOGW(TAG, "batch_rb full, dropping telemetry until a batch is sent");
+        dropping = true;
+        return false;
+    }
+    if (dropping)
+    {
+        ESP_LOGI(TAG, "batch_rb has room again, telemetry resumed");
+        dropping = false;
     }
+
+    current_batch->batch_start_timestamp = xTaskGetTickCount();
+    current_batch->sample_rate_hz = sensor_get_sample_rate_hz();
+    current_batch->accel_lsb_per_g = accel_lsb_per_g;
+    batch_accel_lsb_per_g = accel_lsb_per_g;
+#if SENSOR_GYRO_ENABLED
+    current_batch->gyro_lsb_per_dps = sensor_get_gyro_lsb_per_dps();
+    current_batch->temperature_c = sensor_get_temperature_c();
+#endif
+    return true;
+}
+
+static void commit_batch(void)
+{
+    current_batch->sample_count = batch_index;
+    ring_buffer_commit_back(batch_rb);
+
+    current_batch = NULL;
+    batch_index = 0;
 }
 
+#if SENSOR_GYRO_ENABLED
+// Back to sensor counts, rounded: calibration has rotated the values and
+// taken the bias off, so they are no longer whole counts
+static int16_t to_counts(float value, float lsb_per_unit)
+{
+    float counts = roundf(value * lsb_per_unit);
+    if (counts > INT16_MAX)
+        return INT16_MAX;
+    if (counts < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)counts;
+}
+#endif
+
 static void batch_telemetry_reading(const sensor_reading_t *data)
 {
-    if (batch_index == 0)
+    // A batch has one sample rate and scale; after a set_imu, send what was
+    // collected under the old settings and start over. The scale comes from
+    // the reading, since sensor_rb may still hold readings from the old range.
+    // Compared as integers: fixed-point builds keep this path off the FPU.
+    uint16_t accel_lsb_per_g = sensor_accel_lsb_per_g(data->accel_range_g);
+    if (current_batch && (current_batch->sample_rate_hz != sensor_get_sample_rate_hz() ||
+                          batch_accel_lsb_per_g != accel_lsb_per_g))
+    {
+        if (batch_index > 0)
+        {
+            commit_batch();
+        }
+        else
+        {
+            current_batch->sample_rate_hz = sensor_get_sample_rate_hz();
+            current_batch->accel_lsb_per_g = accel_lsb_per_g;
+            batch_accel_lsb_per_g = accel_lsb_per_g;
+        }
+    }
+
+    if (!current_batch && !start_batch(accel_lsb_per_g))
     {
-        current_batch.batch_start_timestamp = xTaskGetTickCount();
+        return;
     }
 
-    current_batch.samples[batch_index] = *data;
+    sensor_raw_sample_t *sample = &current_batch->samples[batch_index];
+    sample->x = accel_to_counts(data->x, batch_accel_lsb_per_g);
+    sample->y = accel_to_counts(data->y, batch_accel_lsb_per_g);
+    sample->z = accel_to_counts(data->z, batch_accel_lsb_per_g);
+#if SENSOR_GYRO_ENABLED
+    sample->gx = to_counts(data->gx, current_batch->gyro_lsb_per_dps);
+    sample->gy = to_counts(data->gy, current_batch->gyro_lsb_per_dps);
+    sample->gz = to_counts(data->gz, current_batch->gyro_lsb_per_dps);
+#endif
     batch_index++;
 
     if (batch_index >= LOG_BATCH_SIZE)
     {
-        current_batch.sample_count = batch_index;
+        commit_batch();
+    }
+}
 
-        if (!ring_buffer_push_back_with_full_log(batch_rb, &current_batch,
-                                                 "batch_rb full, overwrote oldest batch"))
-        {
-            ESP_LOGW(TAG, "batch_rb: failed to push telemetry batch");
-        }
+// A threshold at or above full scale can never be reached
+static void warn_if_unreachable(const char *name, float threshold_g, uint8_t range_g)
+{
+    if (threshold_g >= range_g)
+    {
+        ESP_LOGW(TAG, "%s threshold %.1f g is at or above the +-%u g range",
+                 name, threshold_g, range_g);
+    }
+}
 
-        batch_index = 0;
+static void handle_set_imu(const mqtt_command_t *cmd)
+{
+    sensor_config_t config;
+    sensor_get_config(&config);
+
+    if (cmd->data.set_imu.sample_rate_hz != IMU_CONFIG_UNCHANGED)
+        config.sample_rate_hz = cmd->data.set_imu.sample_rate_hz;
+    if (cmd->data.set_imu.accel_range_g != IMU_CONFIG_UNCHANGED)
+        config.accel_range_g = (uint8_t)cmd->data.set_imu.accel_range_g;
+    if (cmd->data.set_imu.dlpf_hz != IMU_CONFIG_UNCHANGED)
+        config.dlpf_hz = cmd->data.set_imu.dlpf_hz;
+
+    esp_err_t ret = sensor_set_config(&config);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Rejected IMU config: %u Hz, +-%u g, dlpf %u Hz",
+                 config.sample_rate_hz, config.accel_range_g, config.dlpf_hz);
+        return;
+    }
+
+    ESP_LOGI(TAG, "IMU config requested: %u Hz, +-%u g, dlpf %u Hz",
+             config.sample_rate_hz, config.accel_range_g, config.dlpf_hz);
+    for (int i = 0; i < DETECTOR_COUNT; i++)
+    {
+        warn_if_unreachable(detector_get_name((detector_type_t)i),
+                            detector_get_threshold((detector_type_t)i), config.accel_range_g);
     }
 }
 
 static void send_status_response(void)
 {
-    mqtt_command_t response = {
-        .type = MQTT_RESP_STATUS,
-        .data.status = {
-            .crash = detector_get_threshold(DETECTOR_CRASH),
-            .braking = detector_get_threshold(DETECTOR_HARSH_BRAKING),
-            .accel = detector_get_threshold(DETECTOR_HARSH_ACCEL),
-            .cornering = detector_get_threshold(DETECTOR_HARSH_CORNERING)}};
-
+    mqtt_message_t response = {
+        .type = MSG_STATUS,
+        .data.status.threshold = {
+#define X(id, ...) [THRESHOLD_##id] = detector_get_threshold(DETECTOR_##id),
+            DETECTOR_LIST(X)
+#undef X
+        }};
 
-    if (!ring_buffer_push_back_with_full_log(mqtt_response_queue, &response,
-                                             "Response queue full, overwrote oldest response"))
+    if (!priority_queue_push(mqtt_rb, MQTT_LANE_STATUS, &response, NULL))
     {
         ESP_LOGW(TAG, "Failed to queue status response");
     }
@@ -105,18 +338,12 @@ static void handle_mqtt_command(const mqtt_command_t *cmd)
         detector_type_t detector;
         switch (cmd->data.set_threshold.threshold)
         {
-        case THRESHOLD_CRASH:
-            detector = DETECTOR_CRASH;
-            break;
-        case THRESHOLD_BRAKING:
-            detector = DETECTOR_HARSH_BRAKING;
-            break;
-        case THRESHOLD_ACCEL:
-            detector = DETECTOR_HARSH_ACCEL;
-            break;
-        case THRESHOLD_CORNERING:
-            detector = DETECTOR_HARSH_CORNERING;
+#define X(id, ...)                    \
+        case THRESHOLD_##id:          \
+            detector = DETECTOR_##id; \
             break;
+        DETECTOR_LIST(X)
+#undef X
         default:
             ESP_LOGW(TAG, "Unknown threshold type: %d", cmd->data.set_threshold.threshold);
             return;
@@ -126,10 +353,40 @@ static void handle_mqtt_command(const mqtt_command_t *cmd)
         ESP_LOGI(TAG, "Set %s threshold to %.1f G",
                  detector_get_name(detector), cmd->data.set_threshold.value);
 
+        sensor_config_t imu;
+        sensor_get_config(&imu);
+        warn_if_unreachable(detector_get_name(detector), cmd->data.set_threshold.value,
+                            imu.accel_range_g);
+
         send_status_response();
         break;
     }
 
+    case MQTT_CMD_SET_IMU:
+        handle_set_imu(cmd);
+        break;
+
+    case MQTT_CMD_CALIBRATE:
+#if !defined(MOCK_SENSOR_DATA) && !defined(REPLAY_SENSOR_DATA)
+        ESP_LOGI(TAG, "Mounting calibration requested");
+        calibration_request();
+#else
+        ESP_LOGW(TAG, "No mounting calibration with simulated sensor data");
+#endif
+        break;
+
+    case MQTT_CMD_SET_FILTER:
+    {
+        detector_input_t *input = cmd->data.set_filter.full_stream ? &full_input
+                                                                   : &decimated_input;
+        uint8_t stages = cmd->data.set_filter.stages == FILTER_STAGES_UNCHANGED
+                             ? input->filter.stages
+                             : cmd->data.set_filter.stages;
+        design_filter(input, stages, cmd->data.set_filter.cutoff_hz,
+                      input->filter.sample_rate_hz);
+        break;
+    }
+
     case MQTT_CMD_GET_STATUS:
         ESP_LOGI(TAG, "Status requested");
         send_status_response();
@@ -0,0 +1,188 @@
+#include "priority_queue.h"
+#include "ring_buffer.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+static const char *TAG = "priority_queue";
+
+// Lane buffers and their mutexes live inside the struct and share one
+// storage block, so the static and heap constructors build lanes the same way
+static priority_queue_t *init(priority_queue_t *pq, const priority_lane_config_t *lanes,
+                              size_t lane_count, size_t item_size, uint8_t *storage,
+                              bool owns_memory)
+{
+    pq->lane_count = lane_count;
+    pq->pending = 0;
+    pq->consumer = NULL;
+    pq->notify_bits = 0;
+    pq->storage = storage;
+    pq->owns_memory = owns_memory;
+    for (size_t i = 0; i < lane_count; i++)
+    {
+        if (!ring_buffer_create_static(&pq->lanes[i], lanes[i].capacity, item_size,
+                                       RING_BUFFER_SYNC_MUTEX, &lanes[i].overflow, storage,
+                                       &pq->lane_mutexes[i]))
+        {
+            pq->lane_count = i;
+            priority_queue_destroy(pq);
+            return NULL;
+        }
+        storage += lanes[i].capacity * item_size;
+    }
+    return pq;
+}
+
+static bool valid_lanes(const priority_lane_config_t *lanes, size_t lane_count)
+{
+    if (!lanes || lane_count == 0 || lane_count > PRIORITY_QUEUE_MAX_LANES)
+    {
+        ESP_LOGE(TAG, "Invalid lane count: %zu", lane_count);
+        return false;
+    }
+    return true;
+}
+
+priority_queue_t *priority_queue_create(const priority_lane_config_t *lanes, size_t lane_count,
+                                        size_t item_size)
+{
+    if (!valid_lanes(lanes, lane_count))
+        return NULL;
+
+    priority_queue_t *pq = pvPortMalloc(sizeof(priority_queue_t));
+    if (!pq)
+    {
+        ESP_LOGE(TAG, "Failed to allocate priority queue struct");
+        return NULL;
+    }
+
+    uint8_t *storage = pvPortMalloc(priority_queue_storage_size(lanes, lane_count, item_size));
+    if (!storage)
+    {
+        ESP_LOGE(TAG, "Failed to allocate priority queue storage");
+        vPortFree(pq);
+        return NULL;
+    }
+
+    return init(pq, lanes, lane_count, item_size, storage, true);
+}
+
+priority_queue_t *priority_queue_create_static(priority_queue_t *pq,
+                                               const priority_lane_config_t *lanes,
+                                               size_t lane_count, size_t item_size,
+                                               void *storage)
+{
+    if (!pq || !storage || !valid_lanes(lanes, lane_count))
+        return NULL;
+    return init(pq, lanes, lane_count, item_size, storage, false);
+}
+
+size_t priority_queue_storage_size(const priority_lane_config_t *lanes, size_t lane_count,
+                                   size_t item_size)
+{
+    size_t items = 0;
+    for (size_t i = 0; i < lane_count; i++)
+        items += lanes[i].capacity;
+    return items * item_size;
+}
+
+void priority_queue_destroy(priority_queue_t *pq)
+{
+    if (!pq)
+        return;
+    for (size_t i = 0; i < pq->lane_count; i++)
+        ring_buffer_destroy(&pq->lanes[i]);
+    if (pq->owns_memory)
+    {
+        vPortFree(pq->storage);
+        vPortFree(pq);
+    }
+}
+
+bool priority_queue_push(priority_queue_t *pq, size_t lane, const void *item, bool *dropped)
+{
+    if (dropped)
+        *dropped = false;
+    if (!pq || lane >= pq->lane_count)
+        return false;
+
+    bool ok = ring_buffer_push_back(&pq->lanes[lane], item, dropped);
+
+    if (ok)
+    {
+        __atomic_fetch_or(&pq->pending, 1u << lane, __ATOMIC_RELEASE);
+        TaskHandle_t task = __atomic_load_n(&pq->consumer, __ATOMIC_ACQUIRE);
+        if (task)
+            xTaskNotify(task, pq->notify_bits, eSetBits);
+    }
+    return ok;
+}
+
+// Lanes are mutex buffers, so count is only written under the lock; a plain
+// atomic read is enough to tell an empty lane from one whose lock timed out
+static inline size_t lane_count(priority_queue_t *pq, size_t i)
+{
+    return __atomic_load_n(&pq->lanes[i].count, __ATOMIC_ACQUIRE);
+}
+
+// Clears lane i's bit if the lane is empty. A producer sets the bit after its
+// item is in, so one pushing while we clear is caught by the second look.
+static void clear_if_empty(priority_queue_t *pq, size_t i)
+{
+    if (lane_count(pq, i) != 0)
+        return;
+    __atomic_fetch_and(&pq->pending, ~(1u << i), __ATOMIC_ACQ_REL);
+    if (lane_count(pq, i) != 0)
+        __atomic_fetch_or(&pq->pending, 1u << i, __ATOMIC_RELEASE);
+}
+
+bool priority_queue_pop(priority_queue_t *pq, void *item, size_t *lane)
+{
+    if (!pq || !item)
+        return false;
+
+    uint32_t pending;
+    while ((pending = __atomic_load_n(&pq->pending, __ATOMIC_ACQUIRE)) != 0)
+    {
+        size_t i = __builtin_ctz(pending);
+
+        if (ring_buffer_pop_front(&pq->lanes[i], item))
+        {
+            clear_if_empty(pq, i);
+            if (lane)
+                *lane = i;
+            return true;
+        }
+
+        // Still holding items means the lock timed out; keep the bit so the
+        // lane is serviced on the next pop instead of the next push
+        if (lane_count(pq, i) != 0)
+            return false;
+        clear_if_empty(pq, i);
+    }
+    return false;
+}
+
+void priority_queue_set_consumer(priority_queue_t *pq, TaskHandle_t task, uint32_t notify_bits)
+{
+    if (!pq)
+        return;
+    pq->notify_bits = notify_bits;
+    __atomic_store_n(&pq->consumer, task, __ATOMIC_RELEASE);
+}
+
+size_t priority_queue_count(priority_queue_t *pq)
+{
+    if (!pq)
+        return 0;
+    size_t count = 0;
+    for (size_t i = 0; i < pq->lane_count; i++)
+        count += ring_buffer_count(&pq->lanes[i]);
+    return count;
+}
+
+bool priority_queue_get_lane_stats(priority_queue_t *pq, size_t lane, ring_buffer_stats_t *stats)
+{
+    if (!pq || lane >= pq->lane_count)
+        return false;
+    return ring_buffer_get_stats(&pq->lanes[lane], stats);
+}
@@ -0,0 +1,76 @@
+#ifndef PRIORITY_QUEUE_H
+#define PRIORITY_QUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "ring_buffer.h"
+
+// A set of bounded ring buffer lanes sharing one item type. Lane 0 has the
+// highest priority. Lanes never evict each other's items: each one only drops
+// according to its own overflow policy.
+typedef struct priority_queue priority_queue_t;
+
+#define PRIORITY_QUEUE_MAX_LANES 4
+
+typedef struct
+{
+    size_t capacity;
+    ring_buffer_overflow_t overflow;
+} priority_lane_config_t;
+
+// Public only for static allocation; treat every field as private
+struct priority_queue
+{
+    ring_buffer_t lanes[PRIORITY_QUEUE_MAX_LANES];
+    StaticSemaphore_t lane_mutexes[PRIORITY_QUEUE_MAX_LANES];
+    size_t lane_count;
+    uint8_t *storage; // All lanes' items, back to back
+    bool owns_memory;
+    // Bit n set if lane n may hold items. Producers set it after pushing; the
+    // consumer clears it only once it sees the lane empty, and looks again
+    // after clearing, so a set bit is never lost and pop finds the highest
+    // non-empty lane without probing every lane.
+    uint32_t pending;
+    // Woken by push once the pending bit is set, not by the lanes, so a
+    // consumer that wakes always finds the bit
+    TaskHandle_t consumer;
+    uint32_t notify_bits;
+};
+
+// Returns NULL on allocation failure
+priority_queue_t *priority_queue_create(const priority_lane_config_t *lanes, size_t lane_count,
+                                        size_t item_size);
+
+// Heap-free variant: initializes pq in place on caller-provided storage of
+// priority_queue_storage_size() bytes (the sum of the lane capacities, in
+// items). Returns pq, or NULL on invalid arguments.
+priority_queue_t *priority_queue_create_static(priority_queue_t *pq,
+                                               const priority_lane_config_t *lanes,
+                                               size_t lane_count, size_t item_size,
+                                               void *storage);
+
+size_t priority_queue_storage_size(const priority_lane_config_t *lanes, size_t lane_count,
+                                   size_t item_size);
+
+void priority_queue_destroy(priority_queue_t *pq);
+
+// Returns false if the item was neither queued nor merged. If dropped is not
+// NULL, sets to true if the lane was full.
+bool priority_queue_push(priority_queue_t *pq, size_t lane, const void *item, bool *dropped);
+
+// Pops the oldest item of the highest-priority non-empty lane. If lane is not
+// NULL, sets it to the lane the item came from.
+bool priority_queue_pop(priority_queue_t *pq, void *item, size_t *lane);
+
+// Same as ring_buffer_set_consumer, for pushes to any lane
+void priority_queue_set_consumer(priority_queue_t *pq, TaskHandle_t task, uint32_t notify_bits);
+
+size_t priority_queue_count(priority_queue_t *pq);
+
+// Snapshot of one lane's ring buffer counters
+bool priority_queue_get_lane_stats(priority_queue_t *pq, size_t lane, ring_buffer_stats_t *stats);
+
+#endif // PRIORITY_QUEUE_H
@@ -2,25 +2,93 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <string.h>
 
 static const char *TAG = "ring_buffer";
 
 #define MUTEX_TIMEOUT_MS 100
+#define LOCK_TIMEOUT pdMS_TO_TICKS(MUTEX_TIMEOUT_MS)
 
-struct ring_buffer
+ring_buffer_t *ring_buffer_create(size_t capacity, size_t item_size)
 {
-    uint8_t *buffer;
-    size_t capacity;
-    size_t item_size;
-    size_t head;
-    size_t tail;
-    size_t count;
-    SemaphoreHandle_t mutex;
-};
+    return ring_buffer_create_with_sync(capacity, item_size, RING_BUFFER_SYNC_MUTEX);
+}
 
-ring_buffer_t *ring_buffer_create(size_t capacity, size_t item_size)
+ring_buffer_t *ring_buffer_create_with_sync(size_t capacity, size_t item_size,
+                                            ring_buffer_sync_t sync)
 {
+    return ring_buffer_create_with_overflow(capacity, item_size, sync, NULL);
+}
+
+// Fills in the default for overflow == NULL. The producer cannot evict or
+// modify queued items without a lock, so SPSC only drops or blocks.
+static bool resolve_overflow(ring_buffer_sync_t sync, const ring_buffer_overflow_t *overflow,
+                             ring_buffer_overflow_t *out)
+{
+    if (!overflow)
+    {
+        *out = (ring_buffer_overflow_t){
+            .policy = sync == RING_BUFFER_SYNC_SPSC ? RING_BUFFER_DROP_NEWEST
+                                                    : RING_BUFFER_OVERWRITE_OLDEST,
+        };
+        return true;
+    }
+
+    if (sync == RING_BUFFER_SYNC_SPSC && (overflow->policy == RING_BUFFER_OVERWRITE_OLDEST ||
+                                          overflow->policy == RING_BUFFER_COALESCE))
+    {
+        ESP_LOGE(TAG, "Overflow policy %d not supported in SPSC mode", overflow->policy);
+        return false;
+    }
+    if (overflow->policy == RING_BUFFER_COALESCE && !overflow->coalesce)
+    {
+        ESP_LOGE(TAG, "Coalesce policy needs a callback");
+        return false;
+    }
+    *out = *overflow;
+    return true;
+}
+
+// Shared by both constructors once storage and the mutex exist
+static void init(ring_buffer_t *rb, size_t capacity, size_t item_size, ring_buffer_sync_t sync,
+                 const ring_buffer_overflow_t *overflow, void *storage, SemaphoreHandle_t mutex,
+                 bool owns_memory)
+{
+    rb->buffer = storage;
+    rb->capacity = capacity;
+    rb->slots = RING_BUFFER_SLOTS(capacity, sync);
+    rb->item_size = item_size;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->count = 0;
+    rb->reserved = false;
+    rb->borrowed = false;
+    rb->owns_memory = owns_memory;
+    rb->sync = sync;
+    rb->mutex = mutex;
+    rb->overflow = *overflow;
+    rb->space = NULL;
+    if (overflow->policy == RING_BUFFER_BLOCK)
+        rb->space = xSemaphoreCreateBinaryStatic(&rb->space_buffer);
+    rb->consumer = NULL;
+    rb->notify_bits = 0;
+    memset(&rb->stats, 0, sizeof(rb->stats));
+    rb->typed = NULL;
+
+    ESP_LOGI(TAG, "Created ring buffer: capacity=%zu, item_size=%zu, policy=%d%s%s",
+             capacity, item_size, overflow->policy,
+             sync == RING_BUFFER_SYNC_SPSC ? " (spsc)" : "", owns_memory ? "" : " (static)");
+}
+
+ring_buffer_t *ring_buffer_create_with_overflow(size_t capacity, size_t item_size,
+                                                ring_buffer_sync_t sync,
+                                                const ring_buffer_overflow_t *overflow)
+{
+    ring_buffer_overflow_t resolved;
+    if (!resolve_overflow(sync, overflow, &resolved))
+        return NULL;
+
     ring_buffer_t *rb = pvPortMalloc(sizeof(ring_buffer_t));
     if (!rb)
     {
@@ -28,41 +96,142 @@ ring_buffer_t *ring_buffer_create(size_t capacity, size_t item_size)
         return NULL;
     }
 
-    rb->buffer = pvPortMalloc(capacity * item_size);
-    if (!rb->buffer)
+    uint8_t *buffer = pvPortMalloc(RING_BUFFER_SLOTS(capacity, sync) * item_size);
+    if (!buffer)
     {
         ESP_LOGE(TAG, "Failed to allocate ring buffer storage");
         vPortFree(rb);
         return NULL;
     }
 
-    rb->mutex = xSemaphoreCreateMutex();
-    if (!rb->mutex)
+    SemaphoreHandle_t mutex = NULL;
+    if (sync == RING_BUFFER_SYNC_MUTEX)
     {
-        ESP_LOGE(TAG, "Failed to create mutex");
-        vPortFree(rb->buffer);
-        vPortFree(rb);
+        mutex = xSemaphoreCreateMutex();
+        if (!mutex)
+        {
+            ESP_LOGE(TAG, "Failed to create mutex");
+            vPortFree(buffer);
+            vPortFree(rb);
+            return NULL;
+        }
+    }
+
+    init(rb, capacity, item_size, sync, &resolved, buffer, mutex, true);
+    return rb;
+}
+
+ring_buffer_t *ring_buffer_create_static(ring_buffer_t *rb, size_t capacity, size_t item_size,
+                                         ring_buffer_sync_t sync,
+                                         const ring_buffer_overflow_t *overflow, void *storage,
+                                         StaticSemaphore_t *mutex_buffer)
+{
+    if (!rb || !storage || (sync == RING_BUFFER_SYNC_MUTEX && !mutex_buffer))
+    {
+        ESP_LOGE(TAG, "Static ring buffer needs storage%s",
+                 sync == RING_BUFFER_SYNC_MUTEX ? " and a mutex buffer" : "");
         return NULL;
     }
 
-    rb->capacity = capacity;
-    rb->item_size = item_size;
-    rb->head = 0;
-    rb->tail = 0;
-    rb->count = 0;
+    ring_buffer_overflow_t resolved;
+    if (!resolve_overflow(sync, overflow, &resolved))
+        return NULL;
+
+    SemaphoreHandle_t mutex = NULL;
+    if (sync == RING_BUFFER_SYNC_MUTEX)
+        mutex = xSemaphoreCreateMutexStatic(mutex_buffer);
 
-    ESP_LOGI(TAG, "Created ring buffer: capacity=%zu, item_size=%zu", capacity, item_size);
+    init(rb, capacity, item_size, sync, &resolved, storage, mutex, false);
     return rb;
 }
 
 void ring_buffer_destroy(ring_buffer_t *rb)
 {
-    if (!rb)
+    // A typed queue's handle is static and so is everything behind it
+    if (!rb || rb->typed)
         return;
     if (rb->mutex)
         vSemaphoreDelete(rb->mutex);
-    vPortFree(rb->buffer);
-    vPortFree(rb);
+    if (rb->space)
+        vSemaphoreDelete(rb->space);
+    if (rb->owns_memory)
+    {
+        vPortFree(rb->buffer);
+        vPortFree(rb);
+    }
+}
+
+void ring_buffer_set_consumer(ring_buffer_t *rb, TaskHandle_t task, uint32_t notify_bits)
+{
+    if (!rb)
+        return;
+    if (rb->typed)
+    {
+        rb->typed->set_consumer(task, notify_bits);
+        return;
+    }
+    rb->notify_bits = notify_bits;
+    __atomic_store_n(&rb->consumer, task, __ATOMIC_RELEASE);
+}
+
+// Only blocking acquisitions are timed, so the uncontended path stays as
+// cheap as a bare xSemaphoreTake
+static bool lock(ring_buffer_t *rb, TickType_t timeout)
+{
+    if (xSemaphoreTake(rb->mutex, 0) == pdTRUE)
+        return true;
+
+    int64_t start = esp_timer_get_time();
+    if (xSemaphoreTake(rb->mutex, timeout) != pdTRUE)
+    {
+        __atomic_fetch_add(&rb->stats.lock_failures, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    rb->stats.lock_wait_us += esp_timer_get_time() - start;
+    return true;
+}
+
+static inline void unlock(ring_buffer_t *rb)
+{
+    xSemaphoreGive(rb->mutex);
+}
+
+static inline void record_depth(ring_buffer_t *rb, size_t depth)
+{
+    if (depth > rb->stats.max_depth)
+        rb->stats.max_depth = depth;
+}
+
+// Called after the new items are visible, outside the mutex
+static inline void notify_consumer(ring_buffer_t *rb)
+{
+    TaskHandle_t task = __atomic_load_n(&rb->consumer, __ATOMIC_ACQUIRE);
+    if (task)
+        xTaskNotify(task, rb->notify_bits, eSetBits);
+}
+
+// Called after items are removed, outside the mutex, to wake a producer
+// blocked in wait_for_space
+static inline void signal_space(ring_buffer_t *rb)
+{
+    if (rb->space)
+        xSemaphoreGive(rb->space);
+}
+
+// RING_BUFFER_BLOCK: waits for the consumer to free a slot, or gives up once
+// block_timeout has passed since start. Called without the mutex; the caller
+// re-checks for space since another producer may have taken the slot.
+static bool wait_for_space(ring_buffer_t *rb, TickType_t start)
+{
+    TickType_t waited = xTaskGetTickCount() - start;
+    if (waited >= rb->overflow.block_timeout)
+        return false;
+    return xSemaphoreTake(rb->space, rb->overflow.block_timeout - waited) == pdTRUE;
+}
+
+static inline TickType_t block_start(ring_buffer_t *rb)
+{
+    return rb->overflow.policy == RING_BUFFER_BLOCK ? xTaskGetTickCount() : 0;
 }
 
 static inline void *item_ptr(ring_buffer_t *rb, size_t index)
@@ -70,41 +239,305 @@ static inline void *item_ptr(ring_buffer_t *rb, size_t index)
     return rb->buffer + (index * rb->item_size);
 }
 
-bool ring_buffer_push_back(ring_buffer_t *rb, const void *item, bool *was_full)
+// Copies n items starting at slot index, in at most two spans around the wrap
+static void copy_to_slots(ring_buffer_t *rb, size_t index, const uint8_t *src, size_t n)
 {
-    if (!rb || !item)
+    size_t first = rb->slots - index;
+    if (first > n)
+        first = n;
+    memcpy(item_ptr(rb, index), src, first * rb->item_size);
+    memcpy(rb->buffer, src + first * rb->item_size, (n - first) * rb->item_size);
+}
+
+static void copy_from_slots(ring_buffer_t *rb, size_t index, uint8_t *dst, size_t n)
+{
+    size_t first = rb->slots - index;
+    if (first > n)
+        first = n;
+    memcpy(dst, item_ptr(rb, index), first * rb->item_size);
+    memcpy(dst + first * rb->item_size, rb->buffer, (n - first) * rb->item_size);
+}
+
+static inline size_t spsc_next(const ring_buffer_t *rb, size_t index)
+{
+    index++;
+    return index == rb->slots ? 0 : index;
+}
+
+typedef enum
+{
+    OVERFLOW_ROOM,    // A slot was freed
+    OVERFLOW_MERGED,  // The item was coalesced into the newest one
+    OVERFLOW_DROPPED, // The item was rejected
+} overflow_result_t;
+
+// Applies the overflow policy to a full mutex-mode buffer, with the mutex
+// held. item is NULL for a reservation, which cannot be merged. BLOCK is
+// handled by the callers, which only get here once the wait has failed.
+static overflow_result_t handle_overflow(ring_buffer_t *rb, const void *item)
+{
+    switch (rb->overflow.policy)
+    {
+    case RING_BUFFER_OVERWRITE_OLDEST:
+        if (rb->borrowed)
+            break; // The oldest item is on loan
+        rb->tail = (rb->tail + 1) % rb->capacity;
+        rb->count--;
+        rb->stats.overwrites++;
+        return OVERFLOW_ROOM;
+    case RING_BUFFER_COALESCE:
+    {
+        // With one item left, the newest is also the borrowed front
+        size_t newest = (rb->head + rb->capacity - 1) % rb->capacity;
+        if (item && !(rb->borrowed && rb->count == 1) &&
+            rb->overflow.coalesce(item_ptr(rb, newest), item))
+        {
+            rb->stats.coalesced++;
+            return OVERFLOW_MERGED;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    rb->stats.rejected++;
+    return OVERFLOW_DROPPED;
+}
+
+// --- SPSC path ---
+// head is only written by the producer and tail only by the consumer. Each
+// side publishes its index with release semantics after touching the slot,
+// and reads the other side's index with acquire semantics before touching it.
+
+// Producer side: returns false once the policy gives up on a full buffer
+static bool spsc_wait_for_space(ring_buffer_t *rb, TickType_t start, size_t items)
+{
+    if (rb->overflow.policy != RING_BUFFER_BLOCK)
+    {
+        rb->stats.rejected += items;
+        return false;
+    }
+    if (!wait_for_space(rb, start))
+    {
+        rb->stats.block_timeouts += items;
+        return false;
+    }
+    return true;
+}
+
+// The caller notifies the consumer
+static bool spsc_push_back(ring_buffer_t *rb, const void *item, bool *was_full)
+{
+    TickType_t start = block_start(rb);
+    size_t head = rb->head;
+    size_t next = spsc_next(rb, head);
+    size_t tail;
+    if (was_full)
+        *was_full = false;
+    while (next == (tail = __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE)))
+    {
+        if (was_full)
+            *was_full = true;
+        if (!spsc_wait_for_space(rb, start, 1))
+            return false;
+    }
+
+    memcpy(item_ptr(rb, head), item, rb->item_size);
+    __atomic_store_n(&rb->head, next, __ATOMIC_RELEASE);
+    rb->stats.pushes++;
+    record_depth(rb, (next + rb->slots - tail) % rb->slots);
+    return true;
+}
+
+static bool spsc_peek(ring_buffer_t *rb, void *item, bool consume)
+{
+    size_t tail = rb->tail;
+    if (tail == __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE))
         return false;
 
-    if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(MUTEX_TIMEOUT_MS)) != pdTRUE)
+    memcpy(item, item_ptr(rb, tail), rb->item_size);
+    if (consume)
     {
+        __atomic_store_n(&rb->tail, spsc_next(rb, tail), __ATOMIC_RELEASE);
+        rb->stats.pops++;
+        signal_space(rb);
+    }
+    return true;
+}
+
+static size_t spsc_push_back_n(ring_buffer_t *rb, const uint8_t *items, size_t n,
+                               bool *was_full)
+{
+    TickType_t start = block_start(rb);
+    size_t accepted = 0;
+    while (n > 0)
+    {
+        size_t head = rb->head;
+        size_t tail = __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE);
+        size_t depth = (head + rb->slots - tail) % rb->slots;
+        size_t take = rb->capacity - depth;
+        if (take > n)
+            take = n;
+
+        if (take > 0)
+        {
+            copy_to_slots(rb, head, items, take);
+            __atomic_store_n(&rb->head, (head + take) % rb->slots, __ATOMIC_RELEASE);
+            rb->stats.pushes += take;
+            record_depth(rb, depth + take);
+            notify_consumer(rb);
+            items += take * rb->item_size;
+            n -= take;
+            accepted += take;
+        }
+
+        if (n > 0)
+        {
+            if (was_full)
+                *was_full = true;
+            if (!spsc_wait_for_space(rb, start, n))
+                break;
+        }
+    }
+    return accepted;
+}
+
+static size_t spsc_pop_front_n(ring_buffer_t *rb, uint8_t *items, size_t max_items)
+{
+    size_t tail = rb->tail;
+    size_t head = __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE);
+    size_t n = (head + rb->slots - tail) % rb->slots;
+    if (n > max_items)
+        n = max_items;
+    if (n == 0)
+        return 0;
+
+    copy_from_slots(rb, tail, items, n);
+    __atomic_store_n(&rb->tail, (tail + n) % rb->slots, __ATOMIC_RELEASE);
+    rb->stats.pops += n;
+    signal_space(rb);
+    return n;
+}
+
+static void *spsc_reserve_back(ring_buffer_t *rb, bool *was_full)
+{
+    TickType_t start = block_start(rb);
+    size_t head = rb->head;
+    if (was_full)
+        *was_full = false;
+    while (spsc_next(rb, head) == __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE))
+    {
+        if (was_full)
+            *was_full = true;
+        if (!spsc_wait_for_space(rb, start, 1))
+            return NULL;
+    }
+    return item_ptr(rb, head);
+}
+
+static const void *spsc_borrow_front(ring_buffer_t *rb)
+{
+    size_t tail = rb->tail;
+    if (tail == __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE))
+        return NULL;
+    return item_ptr(rb, tail);
+}
+
+static size_t spsc_count(ring_buffer_t *rb)
+{
+    size_t head = __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE);
+    size_t tail = __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE);
+    return (head + rb->slots - tail) % rb->slots;
+}
+
+// Mutex mode: takes the mutex, waiting for space first under
+// RING_BUFFER_BLOCK. Returns false without the mutex if either wait fails.
+static bool lock_with_space(ring_buffer_t *rb, TickType_t start, size_t items, bool *was_full)
+{
+    if (!lock(rb, LOCK_TIMEOUT))
         return false;
+
+    while (rb->overflow.policy == RING_BUFFER_BLOCK && rb->count >= rb->capacity)
+    {
+        unlock(rb);
+        if (was_full)
+            *was_full = true;
+        if (!wait_for_space(rb, start))
+        {
+            __atomic_fetch_add(&rb->stats.block_timeouts, items, __ATOMIC_RELAXED);
+            return false;
+        }
+        if (!lock(rb, LOCK_TIMEOUT))
+            return false;
     }
+    return true;
+}
 
+// Appends item with the lock held, applying the overflow policy if full.
+// Returns OVERFLOW_ROOM if the item was queued.
+static overflow_result_t push_locked(ring_buffer_t *rb, const void *item, bool *was_full)
+{
     bool full = rb->count >= rb->capacity;
+    if (was_full && full)
+        *was_full = true;
+
+    if (rb->reserved)
+    {
+        rb->stats.rejected++;
+        return OVERFLOW_DROPPED;
+    }
+
     if (full)
     {
-        rb->tail = (rb->tail + 1) % rb->capacity;
-        rb->count--;
-        ESP_LOGW(TAG, "Ring buffer full. Overwriting oldest element");
+        overflow_result_t result = handle_overflow(rb, item);
+        if (result != OVERFLOW_ROOM)
+            return result;
     }
-    // NULL check
-    if (was_full)
-        *was_full = full;
 
     memcpy(item_ptr(rb, rb->head), item, rb->item_size);
     rb->head = (rb->head + 1) % rb->capacity;
     rb->count++;
+    rb->stats.pushes++;
+    record_depth(rb, rb->count);
+    return OVERFLOW_ROOM;
+}
 
-    xSemaphoreGive(rb->mutex);
-    return true;
+bool ring_buffer_push_back(ring_buffer_t *rb, const void *item, bool *was_full)
+{
+    if (!rb || !item)
+        return false;
+    if (rb->typed)
+        return rb->typed->push_back(item, was_full);
+
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+    {
+        bool ok = spsc_push_back(rb, item, was_full);
+        if (ok)
+            notify_consumer(rb);
+        return ok;
+    }
+
+    if (was_full)
+        *was_full = false;
+    if (!lock_with_space(rb, block_start(rb), 1, was_full))
+    {
+        return false;
+    }
+
+    overflow_result_t result = push_locked(rb, item, was_full);
+
+    unlock(rb);
+    if (result == OVERFLOW_ROOM)
+        notify_consumer(rb);
+    return result != OVERFLOW_DROPPED;
 }
 
 bool ring_buffer_push_front(ring_buffer_t *rb, const void *item, bool *was_full)
 {
-    if (!rb || !item)
+    if (!rb || !item || rb->sync == RING_BUFFER_SYNC_SPSC || rb->typed)
         return false;
 
-    if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(MUTEX_TIMEOUT_MS)) != pdTRUE)
+    if (!lock(rb, LOCK_TIMEOUT))
     {
         return false;
     }
@@ -113,11 +546,19 @@ bool ring_buffer_push_front(ring_buffer_t *rb, const void *item, bool *was_full)
     if (was_full)
         *was_full = full;
 
+    if (rb->reserved || rb->borrowed ||
+        (full && rb->overflow.policy != RING_BUFFER_OVERWRITE_OLDEST))
+    {
+        rb->stats.rejected++;
+        unlock(rb);
+        return false;
+    }
+
     if (full)
     {
         // Buffer is full: remove oldest element (at tail) to make room
         rb->tail = (rb->tail + 1) % rb->capacity;
-        ESP_LOGW(TAG, "Ring buffer full. Overwriting oldest element");
+        rb->stats.overwrites++;
     }
 
     // Decrement tail to make room at front (wrapping around if needed)
@@ -134,8 +575,11 @@ bool ring_buffer_push_front(ring_buffer_t *rb, const void *item, bool *was_full)
     {
         rb->head = (rb->tail + 1) % rb->capacity;
     }
+    rb->stats.pushes++;
+    record_depth(rb, rb->count);
 
-    xSemaphoreGive(rb->mutex);
+    unlock(rb);
+    notify_consumer(rb);
     return true;
 }
 
@@ -143,39 +587,47 @@ bool ring_buffer_pop_front(ring_buffer_t *rb, void *item)
 {
     if (!rb || !item)
         return false;
+    if (rb->typed)
+        return rb->typed->pop_front(item);
+
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+        return spsc_peek(rb, item, true);
 
-    if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(MUTEX_TIMEOUT_MS)) != pdTRUE)
+    if (!lock(rb, LOCK_TIMEOUT))
     {
         return false;
     }
 
-    if (rb->count == 0)
+    if (rb->count == 0 || rb->borrowed)
     {
-        xSemaphoreGive(rb->mutex);
+        unlock(rb);
         return false;
     }
 
     memcpy(item, item_ptr(rb, rb->tail), rb->item_size);
     rb->tail = (rb->tail + 1) % rb->capacity;
     rb->count--;
+    rb->stats.pops++;
 
-    xSemaphoreGive(rb->mutex);
+    unlock(rb);
+    signal_space(rb);
     return true;
 }
 
 bool ring_buffer_pop_back(ring_buffer_t *rb, void *item)
 {
-    if (!rb || !item)
+    if (!rb || !item || rb->sync == RING_BUFFER_SYNC_SPSC || rb->typed)
         return false;
 
-    if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(MUTEX_TIMEOUT_MS)) != pdTRUE)
+    if (!lock(rb, LOCK_TIMEOUT))
     {
         return false;
     }
 
-    if (rb->count == 0)
+    // With one item left, the back is also the borrowed front
+    if (rb->count == 0 || (rb->count == 1 && rb->borrowed))
     {
-        xSemaphoreGive(rb->mutex);
+        unlock(rb);
         return false;
     }
 
@@ -183,8 +635,10 @@ bool ring_buffer_pop_back(ring_buffer_t *rb, void *item)
     rb->head = (rb->head + rb->capacity - 1) % rb->capacity;
     memcpy(item, item_ptr(rb, rb->head), rb->item_size);
     rb->count--;
+    rb->stats.pops++;
 
-    xSemaphoreGive(rb->mutex);
+    unlock(rb);
+    signal_space(rb);
     return true;
 }
 
@@ -192,36 +646,339 @@ bool ring_buffer_peek(ring_buffer_t *rb, void *item)
 {
     if (!rb || !item)
         return false;
+    if (rb->typed)
+        return rb->typed->peek(item);
+
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+        return spsc_peek(rb, item, false);
 
-    if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(MUTEX_TIMEOUT_MS)) != pdTRUE)
+    if (!lock(rb, LOCK_TIMEOUT))
     {
         return false;
     }
 
     if (rb->count == 0)
     {
-        xSemaphoreGive(rb->mutex);
+        unlock(rb);
         return false;
     }
 
     memcpy(item, item_ptr(rb, rb->tail), rb->item_size);
-    xSemaphoreGive(rb->mutex);
+    unlock(rb);
     return true;
 }
 
+size_t ring_buffer_push_back_n(ring_buffer_t *rb, const void *items, size_t n, bool *was_full)
+{
+    if (was_full)
+        *was_full = false;
+    if (!rb || !items || n == 0)
+        return 0;
+    if (rb->typed)
+        return rb->typed->push_back_n(items, n, was_full);
+
+    const uint8_t *src = items;
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+        return spsc_push_back_n(rb, src, n, was_full);
+
+    TickType_t start = block_start(rb);
+    if (!lock(rb, LOCK_TIMEOUT))
+    {
+        return 0;
+    }
+
+    size_t accepted = 0;
+    while (n > 0)
+    {
+        if (rb->reserved)
+        {
+            rb->stats.rejected += n;
+            break;
+        }
+
+        size_t free_slots = rb->capacity - rb->count;
+        if (n > free_slots)
+        {
+            if (was_full)
+                *was_full = true;
+
+            if (rb->overflow.policy == RING_BUFFER_OVERWRITE_OLDEST && !rb->borrowed)
+            {
+                if (n >= rb->capacity)
+                {
+                    // Everything queued and all but the last capacity items are
+                    // overwritten. The skipped items count as pushed and
+                    // immediately overwritten.
+                    size_t skip = n - rb->capacity;
+                    rb->stats.pushes += skip;
+                    rb->stats.overwrites += rb->count + skip;
+                    src += skip * rb->item_size;
+                    accepted += skip;
+                    n = rb->capacity;
+                    rb->tail = rb->head;
+                    rb->count = 0;
+                }
+                else
+                {
+                    size_t evict = n - free_slots;
+                    rb->tail = (rb->tail + evict) % rb->capacity;
+                    rb->count -= evict;
+                    rb->stats.overwrites += evict;
+                }
+                free_slots = rb->capacity - rb->count;
+            }
+        }
+
+        size_t take = n < free_slots ? n : free_slots;
+        copy_to_slots(rb, rb->head, src, take);
+        rb->head = (rb->head + take) % rb->capacity;
+        rb->count += take;
+        rb->stats.pushes += take;
+        record_depth(rb, rb->count);
+        src += take * rb->item_size;
+        n -= take;
+        accepted += take;
+        if (n == 0)
+            break;
+
+        if (rb->overflow.policy == RING_BUFFER_BLOCK)
+        {
+            unlock(rb);
+            if (take > 0)
+                notify_consumer(rb);
+            if (!lock_with_space(rb, start, n, was_full))
+                return accepted;
+            continue;
+        }
+
+        // Whatever still does not fit is merged or rejected
+        if (rb->overflow.policy == RING_BUFFER_COALESCE)
+        {
+            for (; n > 0; n--, src += rb->item_size)
+                if (handle_overflow(rb, src) == OVERFLOW_MERGED)
+                    accepted++;
+        }
+        else
+        {
+            rb->stats.rejected += n;
+        }
+        break;
+    }
+
+    unlock(rb);
+    if (accepted > 0)
+        notify_consumer(rb);
+    return accepted;
+}
+
+size_t ring_buffer_pop_front_n(ring_buffer_t *rb, void *items, size_t max_items)
+{
+    if (!rb || !items || max_items == 0)
+        return 0;
+    if (rb->typed)
+        return rb->typed->pop_front_n(items, max_items);
+
+    uint8_t *dst = items;
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+        return spsc_pop_front_n(rb, dst, max_items);
+
+    if (!lock(rb, LOCK_TIMEOUT))
+    {
+        return 0;
+    }
+
+    size_t n = rb->borrowed ? 0 : rb->count;
+    if (n > max_items)
+        n = max_items;
+
+    copy_from_slots(rb, rb->tail, dst, n);
+    rb->tail = (rb->tail + n) % rb->capacity;
+    rb->count -= n;
+    rb->stats.pops += n;
+
+    unlock(rb);
+    if (n > 0)
+        signal_space(rb);
+    return n;
+}
+
+void *ring_buffer_reserve_back(ring_buffer_t *rb, bool *was_full)
+{
+    if (!rb)
+        return NULL;
+    if (rb->typed)
+        return rb->typed->reserve_back(was_full);
+
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+        return spsc_reserve_back(rb, was_full);
+
+    if (was_full)
+        *was_full = false;
+    if (!lock_with_space(rb, block_start(rb), 1, was_full))
+    {
+        return NULL;
+    }
+
+    bool full = rb->count >= rb->capacity;
+    if (was_full && full)
+        *was_full = true;
+
+    if (rb->reserved)
+    {
+        rb->stats.rejected++;
+        unlock(rb);
+        return NULL;
+    }
+
+    if (full && handle_overflow(rb, NULL) != OVERFLOW_ROOM)
+    {
+        unlock(rb);
+        return NULL;
+    }
+
+    rb->reserved = true;
+    void *slot = item_ptr(rb, rb->head);
+
+    unlock(rb);
+    return slot;
+}
+
+void ring_buffer_commit_back(ring_buffer_t *rb)
+{
+    if (!rb)
+        return;
+    if (rb->typed)
+    {
+        rb->typed->commit_back();
+        return;
+    }
+
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+    {
+        __atomic_store_n(&rb->head, spsc_next(rb, rb->head), __ATOMIC_RELEASE);
+        rb->stats.pushes++;
+        record_depth(rb, spsc_count(rb));
+        notify_consumer(rb);
+        return;
+    }
+
+    // No timeout here: giving up would leak the reservation
+    lock(rb, portMAX_DELAY);
+    bool committed = rb->reserved;
+    if (committed)
+    {
+        rb->head = (rb->head + 1) % rb->capacity;
+        rb->count++;
+        rb->reserved = false;
+        rb->stats.pushes++;
+        record_depth(rb, rb->count);
+    }
+    unlock(rb);
+    if (committed)
+        notify_consumer(rb);
+}
+
+const void *ring_buffer_borrow_front(ring_buffer_t *rb)
+{
+    if (!rb)
+        return NULL;
+    if (rb->typed)
+        return rb->typed->borrow_front();
+
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+        return spsc_borrow_front(rb);
+
+    if (!lock(rb, LOCK_TIMEOUT))
+    {
+        return NULL;
+    }
+
+    const void *item = NULL;
+    if (rb->count > 0 && !rb->borrowed)
+    {
+        rb->borrowed = true;
+        item = item_ptr(rb, rb->tail);
+    }
+
+    unlock(rb);
+    return item;
+}
+
+void ring_buffer_release_front(ring_buffer_t *rb)
+{
+    if (!rb)
+        return;
+    if (rb->typed)
+    {
+        rb->typed->release_front();
+        return;
+    }
+
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+    {
+        __atomic_store_n(&rb->tail, spsc_next(rb, rb->tail), __ATOMIC_RELEASE);
+        rb->stats.pops++;
+        signal_space(rb);
+        return;
+    }
+
+    // No timeout here: giving up would leak the borrow
+    lock(rb, portMAX_DELAY);
+    bool released = rb->borrowed;
+    if (released)
+    {
+        rb->tail = (rb->tail + 1) % rb->capacity;
+        rb->count--;
+        rb->borrowed = false;
+        rb->stats.pops++;
+    }
+    unlock(rb);
+    if (released)
+        signal_space(rb);
+}
+
 size_t ring_buffer_count(ring_buffer_t *rb)
 {
     if (!rb)
         return 0;
-    if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(MUTEX_TIMEOUT_MS)) != pdTRUE)
+    if (rb->typed)
+        return rb->typed->count();
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+        return spsc_count(rb);
+    if (!lock(rb, LOCK_TIMEOUT))
     {
         return 0;
     }
     size_t count = rb->count;
-    xSemaphoreGive(rb->mutex);
+    unlock(rb);
     return count;
 }
 
+bool ring_buffer_get_stats(ring_buffer_t *rb, ring_buffer_stats_t *stats)
+{
+    if (!rb || !stats)
+        return false;
+    if (rb->typed)
+        return rb->typed->get_stats(stats);
+
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+    {
+        // Each counter has a single writer; a torn snapshot is off by one at most
+        *stats = rb->stats;
+        stats->depth = spsc_count(rb);
+        return true;
+    }
+
+    if (!lock(rb, LOCK_TIMEOUT))
+    {
+        return false;
+    }
+    *stats = rb->stats;
+    stats->depth = rb->count;
+    unlock(rb);
+    return true;
+}
+
 bool ring_buffer_is_empty(ring_buffer_t *rb)
 {
     return ring_buffer_count(rb) == 0;
@@ -243,12 +1000,32 @@ void ring_buffer_clear(ring_buffer_t *rb)
 {
     if (!rb)
         return;
-    if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(MUTEX_TIMEOUT_MS)) != pdTRUE)
+    if (rb->typed)
     {
+        rb->typed->clear();
+        return;
+    }
+    if (rb->sync == RING_BUFFER_SYNC_SPSC)
+    {
+        // Consumer side: discard everything published so far
+        __atomic_store_n(&rb->tail, __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE),
+                         __ATOMIC_RELEASE);
+        signal_space(rb);
+        return;
+    }
+    if (!lock(rb, LOCK_TIMEOUT))
+    {
+        return;
+    }
+    if (rb->reserved || rb->borrowed)
+    {
+        unlock(rb);
+        ESP_LOGW(TAG, "Not clearing ring buffer with an outstanding loan");
         return;
     }
     rb->head = 0;
     rb->tail = 0;
     rb->count = 0;
-    xSemaphoreGive(rb->mutex);
+    unlock(rb);
+    signal_space(rb);
 }
\ No newline at end of file
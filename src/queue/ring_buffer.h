@@ -4,17 +4,153 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
 
 typedef struct ring_buffer ring_buffer_t;
 
+typedef struct
+{
+    uint32_t pushes;        // Items added
+    uint32_t pops;          // Items removed by a consumer
+    // Items lost to a full buffer, one counter per overflow policy
+    uint32_t overwrites;     // RING_BUFFER_OVERWRITE_OLDEST: oldest evicted
+    uint32_t rejected;       // RING_BUFFER_DROP_NEWEST, or no slot could be freed
+    uint32_t block_timeouts; // RING_BUFFER_BLOCK: no space within the timeout
+    uint32_t coalesced;      // RING_BUFFER_COALESCE: merged into the newest item
+    uint32_t lock_failures; // Mutex not acquired within the timeout
+    size_t depth;           // Items queued when the snapshot was taken
+    size_t max_depth;       // High-water mark of depth
+    uint64_t lock_wait_us;  // Total time spent blocked on the mutex
+} ring_buffer_stats_t;
+
+typedef enum
+{
+    // Any number of producers and consumers, guarded by a mutex
+    RING_BUFFER_SYNC_MUTEX,
+    // Exactly one producer task and one consumer task, lock-free.
+    // A full buffer rejects the new item instead of overwriting the oldest,
+    // and push_front/pop_back are not supported.
+    RING_BUFFER_SYNC_SPSC,
+} ring_buffer_sync_t;
+
+// What a push does when the buffer is full
+typedef enum
+{
+    // Evict the oldest item. Mutex mode only; its default.
+    RING_BUFFER_OVERWRITE_OLDEST,
+    // Reject the new item. The SPSC default.
+    RING_BUFFER_DROP_NEWEST,
+    // Wait up to block_timeout for the consumer to make room, then reject
+    RING_BUFFER_BLOCK,
+    // Merge the new item into the newest queued one. Mutex mode only.
+    RING_BUFFER_COALESCE,
+} ring_buffer_policy_t;
+
+// Merges item into newest in place, with the buffer locked. Returns false if
+// the two cannot be merged, in which case the new item is rejected.
+typedef bool (*ring_buffer_coalesce_fn)(void *newest, const void *item);
+
+typedef struct
+{
+    ring_buffer_policy_t policy;
+    TickType_t block_timeout;         // RING_BUFFER_BLOCK only
+    ring_buffer_coalesce_fn coalesce; // RING_BUFFER_COALESCE only
+} ring_buffer_overflow_t;
+
+// Entry points of a TypedRingBuffer instance (typed_ring_buffer.hpp). A
+// ring_buffer_t carrying them forwards every call, so code written against
+// ring_buffer_t can sit on a typed queue unchanged.
+typedef struct
+{
+    void (*set_consumer)(TaskHandle_t task, uint32_t notify_bits);
+    bool (*push_back)(const void *item, bool *was_full);
+    size_t (*push_back_n)(const void *items, size_t n, bool *was_full);
+    bool (*pop_front)(void *item);
+    size_t (*pop_front_n)(void *items, size_t max_items);
+    bool (*peek)(void *item);
+    void *(*reserve_back)(bool *was_full);
+    void (*commit_back)(void);
+    const void *(*borrow_front)(void);
+    void (*release_front)(void);
+    size_t (*count)(void);
+    void (*clear)(void);
+    bool (*get_stats)(ring_buffer_stats_t *stats);
+} ring_buffer_typed_ops_t;
+
+// The definition is public only so buffers can be allocated statically with
+// ring_buffer_create_static. Treat every field as private.
+struct ring_buffer
+{
+    uint8_t *buffer;
+    size_t capacity;
+    size_t slots; // SPSC keeps one slot empty to tell full from empty
+    size_t item_size;
+    size_t head;
+    size_t tail;
+    size_t count; // Unused in SPSC mode (derived from head and tail)
+    bool reserved; // Slot at head is on loan to the producer
+    bool borrowed; // Slot at tail is on loan to the consumer
+    bool owns_memory; // Allocated by ring_buffer_create*, freed by destroy
+    ring_buffer_sync_t sync;
+    SemaphoreHandle_t mutex;
+    ring_buffer_overflow_t overflow;
+    SemaphoreHandle_t space; // RING_BUFFER_BLOCK: given after every pop
+    StaticSemaphore_t space_buffer;
+    TaskHandle_t consumer;
+    uint32_t notify_bits;
+    // Mutex mode: updated under the mutex (lock_failures atomically).
+    // SPSC mode: pops by the consumer, everything else by the producer.
+    ring_buffer_stats_t stats;
+    // Set on a typed queue's handle; NULL for buffers made by create*
+    const ring_buffer_typed_ops_t *typed;
+};
+
+// Item slots a buffer of the given capacity needs (SPSC keeps one empty)
+#define RING_BUFFER_SLOTS(capacity, sync) \
+    ((sync) == RING_BUFFER_SYNC_SPSC ? (capacity) + 1 : (capacity))
+
 // Returns NULL on allocation failure
 ring_buffer_t *ring_buffer_create(size_t capacity, size_t item_size);
 
+ring_buffer_t *ring_buffer_create_with_sync(size_t capacity, size_t item_size,
+                                            ring_buffer_sync_t sync);
+
+// overflow NULL selects the default policy for sync. Returns NULL on
+// allocation failure or a policy the sync mode does not support.
+ring_buffer_t *ring_buffer_create_with_overflow(size_t capacity, size_t item_size,
+                                                ring_buffer_sync_t sync,
+                                                const ring_buffer_overflow_t *overflow);
+
+// Heap-free variant: initializes rb in place on caller-provided storage of
+// RING_BUFFER_SLOTS(capacity, sync) items. mutex_buffer is required in mutex
+// mode and ignored otherwise. Returns rb, or NULL on invalid arguments.
+ring_buffer_t *ring_buffer_create_static(ring_buffer_t *rb, size_t capacity, size_t item_size,
+                                         ring_buffer_sync_t sync,
+                                         const ring_buffer_overflow_t *overflow, void *storage,
+                                         StaticSemaphore_t *mutex_buffer);
+
+// Frees what ring_buffer_create* allocated; for static buffers only deletes
+// the mutex.
 void ring_buffer_destroy(ring_buffer_t *rb);
 
-// Overwrites oldest if full. If was_full is not NULL, sets to true if overwritten.
+// Sets notify_bits on task (eSetBits) every time items are added, so the
+// consumer can block in xTaskNotifyWait instead of polling. NULL disables.
+void ring_buffer_set_consumer(ring_buffer_t *rb, TaskHandle_t task, uint32_t notify_bits);
+
+// Applies the overflow policy if full. Returns false if the item was neither
+// queued nor merged. If was_full is not NULL, sets to true if the buffer was
+// full.
 bool ring_buffer_push_back(ring_buffer_t *rb, const void *item, bool *was_full);
 
+// Overwrites the oldest item if full under RING_BUFFER_OVERWRITE_OLDEST and
+// is rejected under every other policy
 bool ring_buffer_push_front(ring_buffer_t *rb, const void *item, bool *was_full);
 
 bool ring_buffer_pop_front(ring_buffer_t *rb, void *item);
@@ -22,10 +158,45 @@ bool ring_buffer_pop_front(ring_buffer_t *rb, void *item);
 bool ring_buffer_pop_back(ring_buffer_t *rb, void *item);
 
 bool ring_buffer_peek(ring_buffer_t *rb, void *item);
+
+// Bulk variants: copy several items under a single lock acquisition.
+// push_back_n returns the number of items queued or merged, applying the
+// overflow policy to those that do not fit (a borrowed front cannot be
+// overwritten). If was_full is not NULL, sets to true if any item did not fit.
+size_t ring_buffer_push_back_n(ring_buffer_t *rb, const void *items, size_t n, bool *was_full);
+
+// Copies up to max_items of the oldest items into items and returns how many
+size_t ring_buffer_pop_front_n(ring_buffer_t *rb, void *items, size_t max_items);
+
+// Loan API: fill or read a slot in place instead of copying through a local.
+// At most one reservation and one borrow may be outstanding at a time.
+
+// Returns the slot behind the newest item, or NULL if a reservation is already
+// outstanding or no slot can be freed. Frees a slot the same way push_back
+// does, except that COALESCE behaves like DROP_NEWEST; the item only becomes
+// visible to consumers on commit. push_back and push_front fail while a
+// reservation is outstanding.
+void *ring_buffer_reserve_back(ring_buffer_t *rb, bool *was_full);
+void ring_buffer_commit_back(ring_buffer_t *rb);
+
+// Returns the oldest item in place, or NULL if empty or already borrowed.
+// The item stays in the buffer, and cannot be overwritten, until released.
+// pop_front and push_front fail while an item is borrowed.
+const void *ring_buffer_borrow_front(ring_buffer_t *rb);
+void ring_buffer_release_front(ring_buffer_t *rb);
+
 size_t ring_buffer_count(ring_buffer_t *rb);
+
+// Copies the counters above. Returns false if the mutex could not be taken.
+bool ring_buffer_get_stats(ring_buffer_t *rb, ring_buffer_stats_t *stats);
 bool ring_buffer_is_empty(ring_buffer_t *rb);
 bool ring_buffer_is_full(ring_buffer_t *rb);
 size_t ring_buffer_capacity(ring_buffer_t *rb);
+// SPSC: call from the consumer only
 void ring_buffer_clear(ring_buffer_t *rb);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // RING_BUFFER_H
@@ -0,0 +1,663 @@
+#ifndef TYPED_RING_BUFFER_HPP
+#define TYPED_RING_BUFFER_HPP
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "queue/ring_buffer.h"
+
+// Compile-time counterpart of ring_buffer_t for a single item type.
+//
+// Items are copied by assignment (a fixed-size move instead of a runtime
+// memcpy), and indices wrap with a compare instead of `%`: with a
+// power-of-two capacity head and tail are free-running counters reduced
+// with a mask. All storage, including the mutex, lives inside the object, so
+// a global instance needs no heap.
+//
+// Semantics match the generic buffer for the two policies it supports:
+// RING_BUFFER_OVERWRITE_OLDEST (mutex mode, its default) and
+// RING_BUFFER_DROP_NEWEST (the SPSC default). try_push_back always rejects.
+// The consumer task is notified after every successful push. Loans
+// (reserve_back/borrow_front) block pushes and pops the same way; there is
+// no push_front, pop_back or block/coalesce policy.
+//
+// TYPED_RING_BUFFER_DEFINE below also puts an instance behind a
+// ring_buffer_t handle, so an existing queue switches to it without changing
+// its producers or consumers.
+
+#ifdef __cplusplus
+
+#include <type_traits>
+
+template <typename T, size_t Capacity, ring_buffer_sync_t Sync = RING_BUFFER_SYNC_MUTEX,
+          ring_buffer_policy_t Policy = Sync == RING_BUFFER_SYNC_SPSC
+                                            ? RING_BUFFER_DROP_NEWEST
+                                            : RING_BUFFER_OVERWRITE_OLDEST>
+class TypedRingBuffer
+{
+    static_assert(Capacity > 0, "TypedRingBuffer needs a capacity");
+    static_assert(Policy == RING_BUFFER_DROP_NEWEST ||
+                      (Policy == RING_BUFFER_OVERWRITE_OLDEST && Sync == RING_BUFFER_SYNC_MUTEX),
+                  "TypedRingBuffer supports overwrite-oldest (mutex mode) and drop-newest");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "TypedRingBuffer items are copied by value");
+
+    static constexpr bool POW2 = (Capacity & (Capacity - 1)) == 0;
+    static constexpr size_t MASK = Capacity - 1;
+    // Without a power of two, indices run over [0, 2 * Capacity) so a full
+    // buffer (distance Capacity) still differs from an empty one
+    static constexpr size_t WRAP = 2 * Capacity;
+    static constexpr bool OVERWRITE = Policy == RING_BUFFER_OVERWRITE_OLDEST;
+    static constexpr TickType_t LOCK_TIMEOUT = pdMS_TO_TICKS(100);
+
+public:
+    TypedRingBuffer()
+    {
+        if (Sync == RING_BUFFER_SYNC_MUTEX)
+            mutex_ = xSemaphoreCreateMutexStatic(&mutex_buffer_);
+    }
+
+    TypedRingBuffer(const TypedRingBuffer &) = delete;
+    TypedRingBuffer &operator=(const TypedRingBuffer &) = delete;
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    void set_consumer(TaskHandle_t task, uint32_t notify_bits)
+    {
+        notify_bits_ = notify_bits;
+        __atomic_store_n(&consumer_, task, __ATOMIC_RELEASE);
+    }
+
+    bool push_back(const T &item, bool *was_full = nullptr)
+    {
+        return push(item, OVERWRITE, was_full);
+    }
+
+    bool try_push_back(const T &item, bool *was_full = nullptr)
+    {
+        return push(item, false, was_full);
+    }
+
+    // Returns the number of items accepted. Overwrite-oldest keeps the newest
+    // Capacity items; drop-newest takes only what fits.
+    size_t push_back_n(const T *items, size_t n, bool *was_full = nullptr)
+    {
+        if (was_full)
+            *was_full = false;
+
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            size_t head = head_;
+            size_t depth = distance(head, __atomic_load_n(&tail_, __ATOMIC_ACQUIRE));
+            size_t free_slots = reserved_ ? 0 : Capacity - depth;
+            if (n > free_slots)
+            {
+                if (was_full)
+                    *was_full = true;
+                stats_.rejected += n - free_slots;
+                n = free_slots;
+            }
+            if (n == 0)
+                return 0;
+            copy_in(head, items, n);
+            __atomic_store_n(&head_, advance(head, n), __ATOMIC_RELEASE);
+            stats_.pushes += n;
+            record_depth(depth + n);
+            notify_consumer();
+            return n;
+        }
+
+        if (!lock())
+            return 0;
+        if (reserved_)
+        {
+            stats_.rejected += n;
+            unlock();
+            return 0;
+        }
+        size_t accepted = n;
+        size_t free_slots = Capacity - distance(head_, tail_);
+        if (n > free_slots)
+        {
+            if (was_full)
+                *was_full = true;
+            if (OVERWRITE && !borrowed_)
+            {
+                if (n > Capacity)
+                {
+                    // Only the newest Capacity items survive
+                    stats_.pushes += n - Capacity;
+                    stats_.overwrites += n - Capacity;
+                    items += n - Capacity;
+                    n = Capacity;
+                }
+                if (n > free_slots)
+                {
+                    stats_.overwrites += n - free_slots;
+                    tail_ = advance(tail_, n - free_slots);
+                }
+            }
+            else
+            {
+                stats_.rejected += n - free_slots;
+                n = accepted = free_slots;
+            }
+        }
+        copy_in(head_, items, n);
+        head_ = advance(head_, n);
+        stats_.pushes += n;
+        record_depth(distance(head_, tail_));
+        unlock();
+        if (accepted)
+            notify_consumer();
+        return accepted;
+    }
+
+    bool pop_front(T &item)
+    {
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            size_t tail = tail_;
+            if (borrowed_ || tail == __atomic_load_n(&head_, __ATOMIC_ACQUIRE))
+                return false;
+            item = items_[slot(tail)];
+            __atomic_store_n(&tail_, advance(tail, 1), __ATOMIC_RELEASE);
+            stats_.pops++;
+            return true;
+        }
+
+        if (!lock())
+            return false;
+        bool ok = head_ != tail_ && !borrowed_;
+        if (ok)
+        {
+            item = items_[slot(tail_)];
+            tail_ = advance(tail_, 1);
+            stats_.pops++;
+        }
+        unlock();
+        return ok;
+    }
+
+    size_t pop_front_n(T *items, size_t max_items)
+    {
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            if (borrowed_)
+                return 0;
+            size_t tail = tail_;
+            size_t n = distance(__atomic_load_n(&head_, __ATOMIC_ACQUIRE), tail);
+            if (n > max_items)
+                n = max_items;
+            copy_out(tail, items, n);
+            __atomic_store_n(&tail_, advance(tail, n), __ATOMIC_RELEASE);
+            stats_.pops += n;
+            return n;
+        }
+
+        if (!lock())
+            return 0;
+        size_t n = borrowed_ ? 0 : distance(head_, tail_);
+        if (n > max_items)
+            n = max_items;
+        copy_out(tail_, items, n);
+        tail_ = advance(tail_, n);
+        stats_.pops += n;
+        unlock();
+        return n;
+    }
+
+    bool peek(T &item)
+    {
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            size_t tail = tail_;
+            if (tail == __atomic_load_n(&head_, __ATOMIC_ACQUIRE))
+                return false;
+            item = items_[slot(tail)];
+            return true;
+        }
+
+        if (!lock())
+            return false;
+        bool ok = head_ != tail_;
+        if (ok)
+            item = items_[slot(tail_)];
+        unlock();
+        return ok;
+    }
+
+    // Lends the producer the slot at the back to fill in place; pushes are
+    // rejected until commit_back. NULL if the policy leaves no room.
+    T *reserve_back(bool *was_full = nullptr)
+    {
+        if (was_full)
+            *was_full = false;
+
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            bool full = distance(head_, __atomic_load_n(&tail_, __ATOMIC_ACQUIRE)) == Capacity;
+            if (was_full)
+                *was_full = full;
+            if (full || reserved_)
+            {
+                stats_.rejected++;
+                return nullptr;
+            }
+            reserved_ = true;
+            return &items_[slot(head_)];
+        }
+
+        if (!lock())
+            return nullptr;
+        bool full = distance(head_, tail_) == Capacity;
+        if (was_full)
+            *was_full = full;
+        if (reserved_ || (full && (!OVERWRITE || borrowed_)))
+        {
+            stats_.rejected++;
+            unlock();
+            return nullptr;
+        }
+        if (full)
+        {
+            tail_ = advance(tail_, 1);
+            stats_.overwrites++;
+        }
+        reserved_ = true;
+        T *item = &items_[slot(head_)];
+        unlock();
+        return item;
+    }
+
+    void commit_back()
+    {
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            if (!reserved_)
+                return;
+            reserved_ = false;
+            size_t head = advance(head_, 1);
+            __atomic_store_n(&head_, head, __ATOMIC_RELEASE);
+            stats_.pushes++;
+            record_depth(distance(head, __atomic_load_n(&tail_, __ATOMIC_ACQUIRE)));
+            notify_consumer();
+            return;
+        }
+
+        // No timeout here: giving up would leak the reservation
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        bool committed = reserved_;
+        if (committed)
+        {
+            head_ = advance(head_, 1);
+            reserved_ = false;
+            stats_.pushes++;
+            record_depth(distance(head_, tail_));
+        }
+        unlock();
+        if (committed)
+            notify_consumer();
+    }
+
+    // Lends the consumer the oldest item without copying it out; pops are
+    // refused until release_front, which removes it
+    const T *borrow_front()
+    {
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            size_t tail = tail_;
+            if (borrowed_ || tail == __atomic_load_n(&head_, __ATOMIC_ACQUIRE))
+                return nullptr;
+            borrowed_ = true;
+            return &items_[slot(tail)];
+        }
+
+        if (!lock())
+            return nullptr;
+        const T *item = nullptr;
+        if (head_ != tail_ && !borrowed_)
+        {
+            borrowed_ = true;
+            item = &items_[slot(tail_)];
+        }
+        unlock();
+        return item;
+    }
+
+    void release_front()
+    {
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            if (!borrowed_)
+                return;
+            borrowed_ = false;
+            __atomic_store_n(&tail_, advance(tail_, 1), __ATOMIC_RELEASE);
+            stats_.pops++;
+            return;
+        }
+
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        if (borrowed_)
+        {
+            borrowed_ = false;
+            tail_ = advance(tail_, 1);
+            stats_.pops++;
+        }
+        unlock();
+    }
+
+    size_t count()
+    {
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+            return distance(__atomic_load_n(&head_, __ATOMIC_ACQUIRE),
+                            __atomic_load_n(&tail_, __ATOMIC_ACQUIRE));
+
+        if (!lock())
+            return 0;
+        size_t n = distance(head_, tail_);
+        unlock();
+        return n;
+    }
+
+    bool is_empty() { return count() == 0; }
+    bool is_full() { return count() == Capacity; }
+
+    // SPSC mode: consumer side only. Refused while an item is on loan.
+    void clear()
+    {
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            if (!borrowed_)
+                __atomic_store_n(&tail_, __atomic_load_n(&head_, __ATOMIC_ACQUIRE),
+                                 __ATOMIC_RELEASE);
+            return;
+        }
+
+        if (!lock())
+            return;
+        if (!reserved_ && !borrowed_)
+            tail_ = head_;
+        unlock();
+    }
+
+    bool get_stats(ring_buffer_stats_t *stats)
+    {
+        if (!stats)
+            return false;
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            *stats = stats_;
+            stats->depth = count();
+            return true;
+        }
+
+        if (!lock())
+            return false;
+        *stats = stats_;
+        stats->depth = distance(head_, tail_);
+        unlock();
+        return true;
+    }
+
+private:
+    static size_t advance(size_t index, size_t n)
+    {
+        if (POW2)
+            return index + n;
+        index += n; // n <= Capacity, so one subtraction is enough
+        return index >= WRAP ? index - WRAP : index;
+    }
+
+    static size_t distance(size_t head, size_t tail)
+    {
+        if (POW2)
+            return head - tail;
+        return head >= tail ? head - tail : head + WRAP - tail;
+    }
+
+    static size_t slot(size_t index)
+    {
+        if (POW2)
+            return index & MASK;
+        return index >= Capacity ? index - Capacity : index;
+    }
+
+    void copy_in(size_t head, const T *items, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+            items_[slot(advance(head, i))] = items[i];
+    }
+
+    void copy_out(size_t tail, T *items, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+            items[i] = items_[slot(advance(tail, i))];
+    }
+
+    bool push(const T &item, bool overwrite, bool *was_full)
+    {
+        if (was_full)
+            *was_full = false;
+
+        if (Sync == RING_BUFFER_SYNC_SPSC)
+        {
+            size_t head = head_;
+            size_t depth = distance(head, __atomic_load_n(&tail_, __ATOMIC_ACQUIRE));
+            if (was_full)
+                *was_full = depth == Capacity;
+            if (depth == Capacity || reserved_)
+            {
+                stats_.rejected++;
+                return false;
+            }
+            items_[slot(head)] = item;
+            __atomic_store_n(&head_, advance(head, 1), __ATOMIC_RELEASE);
+            stats_.pushes++;
+            record_depth(depth + 1);
+            notify_consumer();
+            return true;
+        }
+
+        if (!lock())
+            return false;
+        bool full = distance(head_, tail_) == Capacity;
+        if (was_full)
+            *was_full = full;
+        if (reserved_ || (full && (!overwrite || borrowed_)))
+        {
+            stats_.rejected++;
+            unlock();
+            return false;
+        }
+        if (full)
+        {
+            tail_ = advance(tail_, 1);
+            stats_.overwrites++;
+        }
+        items_[slot(head_)] = item;
+        head_ = advance(head_, 1);
+        stats_.pushes++;
+        record_depth(distance(head_, tail_));
+        unlock();
+        notify_consumer();
+        return true;
+    }
+
+    // Same as the generic buffer: only blocking acquisitions are timed
+    bool lock()
+    {
+        if (xSemaphoreTake(mutex_, 0) == pdTRUE)
+            return true;
+
+        int64_t start = esp_timer_get_time();
+        if (xSemaphoreTake(mutex_, LOCK_TIMEOUT) != pdTRUE)
+        {
+            __atomic_fetch_add(&stats_.lock_failures, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        stats_.lock_wait_us += esp_timer_get_time() - start;
+        return true;
+    }
+
+    void unlock() { xSemaphoreGive(mutex_); }
+
+    void record_depth(size_t depth)
+    {
+        if (depth > stats_.max_depth)
+            stats_.max_depth = depth;
+    }
+
+    void notify_consumer()
+    {
+        TaskHandle_t task = __atomic_load_n(&consumer_, __ATOMIC_ACQUIRE);
+        if (task)
+            xTaskNotify(task, notify_bits_, eSetBits);
+    }
+
+    T items_[Capacity] = {};
+    // head_ - tail_ (see distance) is the count; slot() maps them to items_
+    size_t head_ = 0;
+    size_t tail_ = 0;
+    // Mutex mode: under the mutex. SPSC: reserved_ is the producer's,
+    // borrowed_ the consumer's.
+    bool reserved_ = false;
+    bool borrowed_ = false;
+    SemaphoreHandle_t mutex_ = nullptr;
+    StaticSemaphore_t mutex_buffer_;
+    TaskHandle_t consumer_ = nullptr;
+    uint32_t notify_bits_ = 0;
+    ring_buffer_stats_t stats_ = {};
+};
+
+#endif // __cplusplus
+
+#ifdef __cplusplus
+// Handle through which the ring_buffer_* functions reach a typed queue. Only
+// the fields those functions read outside the forwarding are filled in.
+inline ring_buffer_t typed_ring_buffer_handle(const ring_buffer_typed_ops_t *ops, size_t capacity,
+                                              size_t item_size, ring_buffer_sync_t sync,
+                                              ring_buffer_policy_t policy)
+{
+    ring_buffer_t rb = {};
+    rb.capacity = capacity;
+    rb.slots = capacity;
+    rb.item_size = item_size;
+    rb.sync = sync;
+    rb.overflow.policy = policy;
+    rb.typed = ops;
+    return rb;
+}
+
+constexpr ring_buffer_policy_t typed_ring_buffer_default_policy(ring_buffer_sync_t sync)
+{
+    return sync == RING_BUFFER_SYNC_SPSC ? RING_BUFFER_DROP_NEWEST : RING_BUFFER_OVERWRITE_OLDEST;
+}
+#endif
+
+// C wrapper. DECLARE goes in a header visible to C code and declares
+// name_push_back(), name_pop_front(), ... taking type pointers, plus
+// name_as_ring_buffer(), which returns the same queue as a ring_buffer_t for
+// code that already uses the generic API. DEFINE goes in exactly one .cpp
+// file and instantiates the buffer behind them.
+#ifdef __cplusplus
+#define TYPED_RING_BUFFER_EXTERN_C extern "C"
+#else
+#define TYPED_RING_BUFFER_EXTERN_C
+#endif
+
+#define TYPED_RING_BUFFER_DECLARE(name, type)                                                     \
+    TYPED_RING_BUFFER_EXTERN_C void name##_set_consumer(TaskHandle_t task, uint32_t notify_bits); \
+    TYPED_RING_BUFFER_EXTERN_C bool name##_push_back(const type *item, bool *was_full);           \
+    TYPED_RING_BUFFER_EXTERN_C bool name##_try_push_back(const type *item, bool *was_full);       \
+    TYPED_RING_BUFFER_EXTERN_C size_t name##_push_back_n(const type *items, size_t n,             \
+                                                         bool *was_full);                         \
+    TYPED_RING_BUFFER_EXTERN_C bool name##_pop_front(type *item);                                 \
+    TYPED_RING_BUFFER_EXTERN_C size_t name##_pop_front_n(type *items, size_t max_items);          \
+    TYPED_RING_BUFFER_EXTERN_C bool name##_peek(type *item);                                      \
+    TYPED_RING_BUFFER_EXTERN_C size_t name##_count(void);                                         \
+    TYPED_RING_BUFFER_EXTERN_C void name##_clear(void);                                           \
+    TYPED_RING_BUFFER_EXTERN_C bool name##_get_stats(ring_buffer_stats_t *stats);                 \
+    TYPED_RING_BUFFER_EXTERN_C ring_buffer_t *name##_as_ring_buffer(void)
+
+// Upper bound on the static RAM a DEFINE takes (checked there), for budgets
+// computed at compile time in C
+#define TYPED_RING_BUFFER_BYTES(type, capacity) \
+    ((capacity) * sizeof(type) + 2 * sizeof(ring_buffer_t) + sizeof(StaticSemaphore_t))
+
+#define TYPED_RING_BUFFER_DEFINE(name, type, capacity, sync)                                      \
+    TYPED_RING_BUFFER_DEFINE_WITH_POLICY(name, type, capacity, sync,                              \
+                                         typed_ring_buffer_default_policy(sync))
+
+#define TYPED_RING_BUFFER_DEFINE_WITH_POLICY(name, type, capacity, sync, policy)                  \
+    static TypedRingBuffer<type, capacity, sync, policy> name##_instance;                         \
+    extern "C" void name##_set_consumer(TaskHandle_t task, uint32_t notify_bits)                  \
+    {                                                                                             \
+        name##_instance.set_consumer(task, notify_bits);                                          \
+    }                                                                                             \
+    extern "C" bool name##_push_back(const type *item, bool *was_full)                            \
+    {                                                                                             \
+        if (was_full)                                                                             \
+            *was_full = false;                                                                    \
+        return item && name##_instance.push_back(*item, was_full);                                \
+    }                                                                                             \
+    extern "C" bool name##_try_push_back(const type *item, bool *was_full)                        \
+    {                                                                                             \
+        if (was_full)                                                                             \
+            *was_full = false;                                                                    \
+        return item && name##_instance.try_push_back(*item, was_full);                            \
+    }                                                                                             \
+    extern "C" size_t name##_push_back_n(const type *items, size_t n, bool *was_full)             \
+    {                                                                                             \
+        if (was_full)                                                                             \
+            *was_full = false;                                                                    \
+        return items ? name##_instance.push_back_n(items, n, was_full) : 0;                       \
+    }                                                                                             \
+    extern "C" bool name##_pop_front(type *item)                                                  \
+    {                                                                                             \
+        return item && name##_instance.pop_front(*item);                                          \
+    }                                                                                             \
+    extern "C" size_t name##_pop_front_n(type *items, size_t max_items)                           \
+    {                                                                                             \
+        return items ? name##_instance.pop_front_n(items, max_items) : 0;                         \
+    }                                                                                             \
+    extern "C" bool name##_peek(type *item)                                                       \
+    {                                                                                             \
+        return item && name##_instance.peek(*item);                                               \
+    }                                                                                             \
+    extern "C" size_t name##_count(void) { return name##_instance.count(); }                      \
+    extern "C" void name##_clear(void) { name##_instance.clear(); }                               \
+    extern "C" bool name##_get_stats(ring_buffer_stats_t *stats)                                  \
+    {                                                                                             \
+        return name##_instance.get_stats(stats);                                                  \
+    }                                                                                             \
+    static const ring_buffer_typed_ops_t name##_ops = {                                           \
+        name##_set_consumer,                                                                      \
+        [](const void *item, bool *was_full)                                                      \
+        { return name##_push_back(static_cast<const type *>(item), was_full); },                  \
+        [](const void *items, size_t n, bool *was_full)                                           \
+        { return name##_push_back_n(static_cast<const type *>(items), n, was_full); },            \
+        [](void *item) { return name##_pop_front(static_cast<type *>(item)); },                   \
+        [](void *items, size_t max_items)                                                         \
+        { return name##_pop_front_n(static_cast<type *>(items), max_items); },                    \
+        [](void *item) { return name##_peek(static_cast<type *>(item)); },                        \
+        [](bool *was_full) -> void * { return name##_instance.reserve_back(was_full); },          \
+        [] { name##_instance.commit_back(); },                                                    \
+        []() -> const void * { return name##_instance.borrow_front(); },                          \
+        [] { name##_instance.release_front(); },                                                  \
+        name##_count,                                                                             \
+        name##_clear,                                                                             \
+        name##_get_stats,                                                                         \
+    };                                                                                            \
+    static ring_buffer_t name##_handle =                                                          \
+        typed_ring_buffer_handle(&name##_ops, capacity, sizeof(type), sync, policy);              \
+    extern "C" ring_buffer_t *name##_as_ring_buffer(void) { return &name##_handle; }              \
+    static_assert(sizeof(name##_instance) + sizeof(name##_handle) <=                              \
+                      TYPED_RING_BUFFER_BYTES(type, capacity),                                    \
+                  "TYPED_RING_BUFFER_BYTES underestimates " #name);
+
+#endif // TYPED_RING_BUFFER_HPP
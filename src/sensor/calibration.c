@@ -0,0 +1,354 @@
+#include "calibration.h"
+#include "config.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "calibration";
+
+#define NVS_NAMESPACE "calibration"
+#define NVS_KEY "mount"
+#define STORED_VERSION 1
+
+typedef enum {
+    STATE_NEED_STILL,  // Waiting for a still window to find gravity
+    STATE_NEED_LAUNCH, // Tilt applied, waiting for a launch to find heading
+    STATE_DONE,
+} calibration_state_t;
+
+// NVS blob; the gyro bias is kept either way so the layout never changes
+typedef struct {
+    uint8_t version;
+    float rotation[3][3];
+    float bias[3];      // g, vehicle frame
+    float gyro_bias[3]; // deg/s, vehicle frame
+} stored_calibration_t;
+
+static stored_calibration_t cal = {
+    .version = STORED_VERSION,
+    .rotation = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},
+};
+static calibration_state_t state = STATE_NEED_STILL;
+
+#if DETECTOR_FIXED_POINT
+// cal in the readings' Q10, for the per-sample correction: rotation in Q14,
+// so a row times a +-24 g vector fits an int32. The estimator runs in floats,
+// but only while calibrating.
+#define ROTATION_ONE (1 << 14)
+static int16_t rotation_q14[3][3];
+static accel_t bias_q10[3];
+
+static void convert_cal(void)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            rotation_q14[i][j] = (int16_t)lrintf(cal.rotation[i][j] * ROTATION_ONE);
+        bias_q10[i] = accel_from_g(cal.bias[i]);
+    }
+}
+
+static int32_t rotate_row(const int16_t row[3], const sensor_reading_t *r)
+{
+    int32_t acc = row[0] * r->x + row[1] * r->y + row[2] * r->z;
+    return (acc + ROTATION_ONE / 2) >> 14;
+}
+#else
+static void convert_cal(void)
+{
+}
+#endif
+
+static portMUX_TYPE request_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool restart_requested = false;
+// A finished calibration for calibration_store_pending(), under request_lock
+static stored_calibration_t to_store;
+static volatile bool store_pending = false;
+
+// Estimator sums, sensor_task only
+static float tilt[3][3];
+static double sum[3], sum_sq[3];
+#if SENSOR_GYRO_ENABLED
+static double gyro_sum[3];
+#endif
+static uint32_t still_count = 0;
+static float heading_sum[2];
+static uint32_t heading_count = 0;
+
+static void rotate(const float m[3][3], float *x, float *y, float *z)
+{
+    float in[3] = {*x, *y, *z};
+    *x = m[0][0] * in[0] + m[0][1] * in[1] + m[0][2] * in[2];
+    *y = m[1][0] * in[0] + m[1][1] * in[1] + m[1][2] * in[2];
+    *z = m[2][0] * in[0] + m[2][1] * in[1] + m[2][2] * in[2];
+}
+
+static void reset_still_window(void)
+{
+    memset(sum, 0, sizeof(sum));
+    memset(sum_sq, 0, sizeof(sum_sq));
+#if SENSOR_GYRO_ENABLED
+    memset(gyro_sum, 0, sizeof(gyro_sum));
+#endif
+    still_count = 0;
+}
+
+static void start(void)
+{
+    static const stored_calibration_t identity = {
+        .version = STORED_VERSION,
+        .rotation = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},
+    };
+    cal = identity;
+    convert_cal();
+    state = STATE_NEED_STILL;
+    reset_still_window();
+    heading_sum[0] = heading_sum[1] = 0.0f;
+    heading_count = 0;
+    ESP_LOGI(TAG, "Calibrating: keep the vehicle still");
+}
+
+static void save(const stored_calibration_t *stored)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK)
+    {
+        ret = nvs_set_blob(handle, NVS_KEY, stored, sizeof(*stored));
+        if (ret == ESP_OK)
+            ret = nvs_commit(handle);
+        nvs_close(handle);
+    }
+    if (ret == ESP_OK)
+        ESP_LOGI(TAG, "Mounting calibration stored");
+    else
+        ESP_LOGE(TAG, "Failed to store calibration: %s", esp_err_to_name(ret));
+}
+
+// Rotation taking unit vector a onto +z (Rodrigues, with v = a x z, c = a . z)
+static void tilt_from_gravity(const float a[3], float m[3][3])
+{
+    float c = a[2];
+    if (c < -0.999f)
+    {
+        // Upside down: half a turn about x
+        const float flip[3][3] = {{1, 0, 0}, {0, -1, 0}, {0, 0, -1}};
+        memcpy(m, flip, sizeof(flip));
+        return;
+    }
+    float vx = a[1], vy = -a[0];
+    float k = 1.0f / (1.0f + c);
+    m[0][0] = 1.0f - vy * vy * k;
+    m[0][1] = vx * vy * k;
+    m[0][2] = vy;
+    m[1][0] = vx * vy * k;
+    m[1][1] = 1.0f - vx * vx * k;
+    m[1][2] = -vx;
+    m[2][0] = -vy;
+    m[2][1] = vx;
+    m[2][2] = c;
+}
+
+static void feed_still(const sensor_reading_t *r)
+{
+    const float v[3] = {accel_to_g(r->x), accel_to_g(r->y), accel_to_g(r->z)};
+    for (int i = 0; i < 3; i++)
+    {
+        sum[i] += v[i];
+        sum_sq[i] += v[i] * v[i];
+    }
+#if SENSOR_GYRO_ENABLED
+    gyro_sum[0] += r->gx;
+    gyro_sum[1] += r->gy;
+    gyro_sum[2] += r->gz;
+#endif
+    if (++still_count < CALIBRATION_STILL_SAMPLES)
+        return;
+
+    float mean[3];
+    for (int i = 0; i < 3; i++)
+    {
+        mean[i] = sum[i] / still_count;
+        float variance = sum_sq[i] / still_count - mean[i] * mean[i];
+        if (variance > CALIBRATION_STILL_MAX_G * CALIBRATION_STILL_MAX_G)
+        {
+            reset_still_window(); // Moved; try the next window
+            return;
+        }
+    }
+
+    float g = sqrtf(mean[0] * mean[0] + mean[1] * mean[1] + mean[2] * mean[2]);
+    if (g < 0.5f)
+    {
+        ESP_LOGW(TAG, "Still window reads %.2f g; is the sensor connected?", g);
+        reset_still_window();
+        return;
+    }
+    const float unit[3] = {mean[0] / g, mean[1] / g, mean[2] / g};
+    tilt_from_gravity(unit, tilt);
+
+    // Whatever gravity reads above or below 1 g is offset
+    memcpy(cal.rotation, tilt, sizeof(tilt));
+    cal.bias[2] = g - 1.0f;
+#if SENSOR_GYRO_ENABLED
+    for (int i = 0; i < 3; i++)
+        cal.gyro_bias[i] = gyro_sum[i] / still_count;
+    rotate(tilt, &cal.gyro_bias[0], &cal.gyro_bias[1], &cal.gyro_bias[2]);
+#endif
+    convert_cal();
+
+    state = STATE_NEED_LAUNCH;
+    ESP_LOGI(TAG, "Gravity %.3f %.3f %.3f (%.1f deg tilt); drive off to find heading", mean[0],
+             mean[1], mean[2], acosf(unit[2]) * 57.29578f);
+}
+
+// A launch is a sustained straight-line pull: CALIBRATION_HEADING_SAMPLES in
+// a row above CALIBRATION_HEADING_MIN_G, none more than
+// CALIBRATION_HEADING_SPREAD_DEG off the run's mean direction. A weak sample
+// or a change of direction (a turn, or braking after the launch) starts over,
+// so scattered pulls never add up to a heading. Gyro builds also reject
+// samples taken while yawing, which rules out a steady corner.
+static bool continues_launch(const sensor_reading_t *r)
+{
+    float x = accel_to_g(r->x), y = accel_to_g(r->y);
+    float h2 = x * x + y * y;
+    if (h2 < CALIBRATION_HEADING_MIN_G * CALIBRATION_HEADING_MIN_G)
+        return false;
+#if SENSOR_GYRO_ENABLED
+    if (fabsf(r->gz) > CALIBRATION_HEADING_MAX_YAW_DPS)
+        return false;
+#endif
+    if (heading_count == 0)
+        return true;
+
+    // cos of the angle to the mean direction, squared to avoid the roots
+    float dot = x * heading_sum[0] + y * heading_sum[1];
+    float mean2 = heading_sum[0] * heading_sum[0] + heading_sum[1] * heading_sum[1];
+    float cos_max = cosf(CALIBRATION_HEADING_SPREAD_DEG * 0.01745329f);
+    return dot > 0.0f && dot * dot >= cos_max * cos_max * h2 * mean2;
+}
+
+// r is already tilt corrected, so x/y is the horizontal plane
+static void feed_launch(const sensor_reading_t *r)
+{
+    if (!continues_launch(r))
+    {
+        heading_sum[0] = heading_sum[1] = 0.0f;
+        heading_count = 0;
+        return;
+    }
+
+    heading_sum[0] += accel_to_g(r->x);
+    heading_sum[1] += accel_to_g(r->y);
+    if (++heading_count < CALIBRATION_HEADING_SAMPLES)
+        return;
+
+    // Yaw that turns the mean launch direction onto +y
+    float yaw = atan2f(heading_sum[0], heading_sum[1]);
+    float c = cosf(yaw), s = sinf(yaw);
+    const float turn[3][3] = {{c, -s, 0}, {s, c, 0}, {0, 0, 1}};
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            cal.rotation[i][j] =
+                turn[i][0] * tilt[0][j] + turn[i][1] * tilt[1][j] + turn[i][2] * tilt[2][j];
+        }
+    }
+#if SENSOR_GYRO_ENABLED
+    rotate(turn, &cal.gyro_bias[0], &cal.gyro_bias[1], &cal.gyro_bias[2]);
+#endif
+    convert_cal();
+
+    state = STATE_DONE;
+    taskENTER_CRITICAL(&request_lock);
+    to_store = cal;
+    store_pending = true;
+    taskEXIT_CRITICAL(&request_lock);
+    ESP_LOGI(TAG, "Heading offset %.1f deg; calibration done", yaw * 57.29578f);
+}
+
+esp_err_t calibration_init(void)
+{
+    nvs_handle_t handle;
+    stored_calibration_t stored;
+    size_t size = sizeof(stored);
+
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK)
+    {
+        ret = nvs_get_blob(handle, NVS_KEY, &stored, &size);
+        nvs_close(handle);
+    }
+
+    if (ret == ESP_OK && size == sizeof(stored) && stored.version == STORED_VERSION)
+    {
+        cal = stored;
+        convert_cal();
+        state = STATE_DONE;
+        ESP_LOGI(TAG, "Loaded mounting calibration");
+        return ESP_OK;
+    }
+    if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND)
+        ESP_LOGW(TAG, "Failed to load calibration: %s", esp_err_to_name(ret));
+
+    start();
+    return ESP_OK;
+}
+
+void calibration_request(void)
+{
+    taskENTER_CRITICAL(&request_lock);
+    restart_requested = true;
+    taskEXIT_CRITICAL(&request_lock);
+}
+
+void calibration_store_pending(void)
+{
+    if (!store_pending)
+        return;
+
+    stored_calibration_t stored;
+    taskENTER_CRITICAL(&request_lock);
+    stored = to_store;
+    store_pending = false;
+    taskEXIT_CRITICAL(&request_lock);
+    save(&stored);
+}
+
+void calibration_apply(sensor_reading_t *r)
+{
+    if (restart_requested)
+    {
+        taskENTER_CRITICAL(&request_lock);
+        restart_requested = false;
+        taskEXIT_CRITICAL(&request_lock);
+        start();
+    }
+
+    if (state == STATE_NEED_STILL)
+        feed_still(r);
+
+#if DETECTOR_FIXED_POINT
+    const sensor_reading_t in = *r;
+    r->x = accel_clamp(rotate_row(rotation_q14[0], &in) - bias_q10[0]);
+    r->y = accel_clamp(rotate_row(rotation_q14[1], &in) - bias_q10[1]);
+    r->z = accel_clamp(rotate_row(rotation_q14[2], &in) - bias_q10[2]);
+#else
+    rotate(cal.rotation, &r->x, &r->y, &r->z);
+    r->x -= cal.bias[0];
+    r->y -= cal.bias[1];
+    r->z -= cal.bias[2];
+#endif
+#if SENSOR_GYRO_ENABLED
+    rotate(cal.rotation, &r->gx, &r->gy, &r->gz);
+    r->gx -= cal.gyro_bias[0];
+    r->gy -= cal.gyro_bias[1];
+    r->gz -= cal.gyro_bias[2];
+#endif
+
+    if (state == STATE_NEED_LAUNCH)
+        feed_launch(r);
+}
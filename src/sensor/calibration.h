@@ -0,0 +1,24 @@
+#pragma once
+#include "message_types.h"
+#include "esp_err.h"
+
+// Mounting correction from sensor axes to vehicle axes (x lateral, y
+// forward, z up): out = rotation * in - bias, one 3x3 multiply per vector.
+// Tilt comes from gravity while standing still; heading from the first
+// launch after that, which is taken to be forwards.
+
+// Loads the stored calibration from NVS, or starts a new one
+esp_err_t calibration_init(void);
+
+// Corrects a sample in place, feeding the estimator while calibrating.
+// sensor_task only.
+void calibration_apply(sensor_reading_t *r);
+
+// Forgets the stored calibration and starts over, e.g. after remounting.
+// Safe from any task; takes effect on the next sample.
+void calibration_request(void);
+
+// Writes a finished calibration to NVS, if one is waiting. A commit can stall
+// for tens of ms, so sensor_task leaves it to mqtt_task, which calls this on
+// every wakeup.
+void calibration_store_pending(void);
@@ -0,0 +1,104 @@
+#include "replay.h"
+#include "config.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "replay";
+
+static const int16_t *samples = NULL;
+static replay_header_t header;
+static int32_t lsb_per_g; // header.accel_lsb_per_g, as the power of two it is
+static uint32_t position = 0;
+static uint32_t passes = 0;
+static uint64_t trace_time_us = 0;
+
+esp_err_t replay_open(const void *data, size_t size)
+{
+    if (size < sizeof(replay_header_t))
+        return ESP_ERR_INVALID_SIZE;
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != REPLAY_VERSION)
+    {
+        ESP_LOGE(TAG, "Not a version %d trace", REPLAY_VERSION);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header.sample_count == 0 || header.sample_rate_hz == 0 ||
+        header.accel_lsb_per_g < 2048.0f || header.accel_lsb_per_g > 16384.0f ||
+        size < sizeof(header) + (size_t)header.sample_count * 3 * sizeof(int16_t))
+    {
+        ESP_LOGE(TAG, "Truncated, empty or out of range trace");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // The header is 16 bytes, so the samples stay 2-byte aligned
+    samples = (const int16_t *)((const uint8_t *)data + sizeof(header));
+    lsb_per_g = lrintf(header.accel_lsb_per_g);
+    position = 0;
+    passes = 0;
+    trace_time_us = 0;
+
+    ESP_LOGI(TAG, "Trace: %lu samples at %u Hz (%lu s)", (unsigned long)header.sample_count,
+             header.sample_rate_hz, (unsigned long)(header.sample_count / header.sample_rate_hz));
+    return ESP_OK;
+}
+
+esp_err_t replay_init(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, REPLAY_PARTITION_LABEL);
+    if (part == NULL)
+    {
+        ESP_LOGE(TAG, "No \"%s\" partition", REPLAY_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Read straight from flash through the cache; nothing is copied to RAM
+    const void *data;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t ret = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA,
+                                       &data, &handle);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to map partition: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = replay_open(data, part->size);
+    if (ret != ESP_OK)
+        esp_partition_munmap(handle);
+    return ret;
+}
+
+uint16_t replay_sample_rate_hz(void)
+{
+    return header.sample_rate_hz;
+}
+
+uint8_t replay_accel_range_g(void)
+{
+    return (uint8_t)(32768.0f / header.accel_lsb_per_g + 0.5f);
+}
+
+sensor_reading_t replay_next(void)
+{
+    const int16_t *s = &samples[position * 3];
+    sensor_reading_t r = {
+        .x = accel_from_counts(s[0], lsb_per_g),
+        .y = accel_from_counts(s[1], lsb_per_g),
+        .z = accel_from_counts(s[2], lsb_per_g),
+        .timestamp_us = (uint32_t)trace_time_us,
+    };
+
+    trace_time_us += 1000000 / header.sample_rate_hz;
+    if (++position == header.sample_count)
+    {
+        position = 0;
+        passes++;
+        ESP_LOGI(TAG, "Trace pass %lu done", (unsigned long)passes);
+    }
+    return r;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "message_types.h"
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Recorded drive, as written by docs/mqtt-sqlite-bridge/export-trace.js:
+// this header, then sample_count int16 x/y/z triplets, all little-endian.
+// g = count / accel_lsb_per_g, as in telemetry batches.
+#define REPLAY_MAGIC "DSMT"
+#define REPLAY_VERSION 1
+
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version;
+    uint16_t sample_rate_hz;
+    float accel_lsb_per_g;
+    uint32_t sample_count;
+} replay_header_t;
+
+// Maps the REPLAY_PARTITION_LABEL data partition and opens the trace in it
+esp_err_t replay_init(void);
+
+// Opens a trace already in memory; data must outlive the replay
+esp_err_t replay_open(const void *data, size_t size);
+
+uint16_t replay_sample_rate_hz(void);
+
+// Full-scale range the trace was recorded at, from its accel_lsb_per_g
+uint8_t replay_accel_range_g(void);
+
+// Next sample, timestamped on the trace's own timeline. Wraps to the start
+// at the end of the trace.
+sensor_reading_t replay_next(void);
@@ -0,0 +1,307 @@
+#include "scenario.h"
+#include "config.h"
+#include "esp_log.h"
+#include <math.h>
+
+static const char *TAG = "scenario";
+
+#define TWO_PI 6.2831853f
+#define GRAVITY_G 1.0f
+#define YAW_DPS_PER_G 37.5f  // Lateral g to yaw rate at ~15 m/s
+#define GYRO_LIMIT_DPS 250.0f // MPU6050 gyro full scale
+#define CRASH_IMPULSE_US 100000
+
+typedef struct {
+    const char *name;
+    uint32_t min_ms;
+    uint32_t max_ms;
+} segment_def_t;
+
+static const segment_def_t segment_defs[SCENARIO_COUNT] = {
+    [SCENARIO_IDLE] = {"idle", 5000, 30000},
+    [SCENARIO_CITY] = {"city", 20000, 120000},
+    [SCENARIO_HIGHWAY] = {"highway", 60000, 300000},
+    [SCENARIO_POTHOLE] = {"pothole", 150, 400},
+    [SCENARIO_HARSH_BRAKING] = {"harsh_braking", 1000, 3000},
+    [SCENARIO_CORNERING] = {"cornering", 2000, 6000},
+    [SCENARIO_CRASH] = {"crash", 2000, 5000},
+    [SCENARIO_SENSOR_FAULT] = {"sensor_fault", 500, 3000},
+};
+
+// A sample as synthesized, in g whatever the readings' accel_t
+typedef struct {
+    float x;
+    float y;
+    float z;
+#if SENSOR_GYRO_ENABLED
+    float gx;
+    float gy;
+    float gz;
+#endif
+    uint32_t timestamp_us;
+} synth_t;
+
+typedef enum {
+    FAULT_STUCK,     // Last sample repeated
+    FAULT_SATURATED, // One axis pinned at full scale
+    FAULT_DROPOUT,   // Bus reads back zeros
+    FAULT_SPIKES,    // Occasional full-scale glitches
+    FAULT_COUNT
+} fault_mode_t;
+
+static uint32_t rng_state = 1;
+static uint8_t weights[SCENARIO_COUNT];
+static uint32_t weight_total = 0;
+
+static uint32_t period_us = 1000000 / IMU_SAMPLE_RATE_HZ;
+static float range_g = IMU_ACCEL_RANGE_G;
+static uint64_t time_us = 0;
+
+// Current segment and the parameters drawn for it
+static scenario_segment_t segment = SCENARIO_IDLE;
+static uint64_t segment_start_us = 0;
+static uint32_t segment_duration_us = 0;
+static float peak = 0.0f;    // Signed g for braking/cornering/potholes, magnitude for crashes
+static float heading = 0.0f; // Crash impact direction in the x/y plane
+static fault_mode_t fault = FAULT_STUCK;
+static synth_t last;
+
+// xorshift32: fast, and the same sequence on device and host
+static uint32_t rng_next(void)
+{
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng_state = x;
+    return x;
+}
+
+static float rng_uniform(float lo, float hi)
+{
+    return lo + (hi - lo) * (rng_next() >> 8) * (1.0f / 16777216.0f);
+}
+
+// Irwin-Hall approximation of a unit normal; plenty for sensor noise
+static float rng_gaussian(void)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < 4; i++)
+        sum += rng_uniform(0.0f, 1.0f);
+    return (sum - 2.0f) * 1.7320508f;
+}
+
+static scenario_segment_t pick_segment(void)
+{
+    if (weight_total == 0)
+        return SCENARIO_IDLE;
+
+    uint32_t pick = rng_next() % weight_total;
+    for (int i = 0; i < SCENARIO_COUNT; i++)
+    {
+        if (pick < weights[i])
+            return (scenario_segment_t)i;
+        pick -= weights[i];
+    }
+    return SCENARIO_IDLE;
+}
+
+static void start_segment(void)
+{
+    segment = pick_segment();
+    const segment_def_t *def = &segment_defs[segment];
+    segment_start_us = time_us;
+    segment_duration_us = (uint32_t)rng_uniform(def->min_ms, def->max_ms) * 1000;
+
+    // Around the thresholds, so detectors see near misses as well as events
+    float sign = (rng_next() & 1) ? 1.0f : -1.0f;
+    switch (segment)
+    {
+    case SCENARIO_POTHOLE:
+        peak = rng_uniform(0.8f, 2.5f);
+        break;
+    case SCENARIO_HARSH_BRAKING:
+        peak = -rng_uniform(0.7f, 1.5f) * DEFAULT_HARSH_BRAKING_THRESHOLD_G;
+        break;
+    case SCENARIO_CORNERING:
+        peak = sign * rng_uniform(0.4f, 1.3f) * DEFAULT_HARSH_CORNERING_THRESHOLD_G;
+        break;
+    case SCENARIO_CRASH:
+        peak = rng_uniform(1.2f, 3.0f) * DEFAULT_CRASH_THRESHOLD_G;
+        heading = rng_uniform(0.0f, TWO_PI);
+        break;
+    case SCENARIO_SENSOR_FAULT:
+        fault = (fault_mode_t)(rng_next() % FAULT_COUNT);
+        peak = sign * range_g;
+        break;
+    default:
+        peak = 0.0f;
+        break;
+    }
+
+    // Ground truth for checking detector output against
+    if (segment >= SCENARIO_HARSH_BRAKING)
+        ESP_LOGI(TAG, "%s at %.2f s, peak %.2f g", def->name, time_us / 1e6f, peak);
+    else
+        ESP_LOGD(TAG, "%s at %.2f s", def->name, time_us / 1e6f);
+}
+
+// 0 to 1 over the first and last fifth of a segment, 1 in between
+static float envelope(float phase)
+{
+    if (phase < 0.2f)
+        return phase * 5.0f;
+    if (phase > 0.8f)
+        return (1.0f - phase) * 5.0f;
+    return 1.0f;
+}
+
+static float clamp_range(float v)
+{
+    return fmaxf(-range_g, fminf(range_g, v));
+}
+
+// City driving: stop-start longitudinal load and gentle turns
+static void add_city(synth_t *r, float t)
+{
+    r->y += 0.2f * sinf(TWO_PI * t / 10.0f) + 0.1f * sinf(TWO_PI * t / 3.7f);
+    r->x += 0.15f * sinf(TWO_PI * t / 13.0f);
+    r->z += 0.04f * rng_gaussian();
+}
+
+static synth_t synthesize(void)
+{
+    uint32_t elapsed_us = (uint32_t)(time_us - segment_start_us);
+    float t = elapsed_us / 1e6f;
+    float phase = (float)elapsed_us / segment_duration_us;
+    synth_t r = {.z = GRAVITY_G, .timestamp_us = (uint32_t)time_us};
+    float noise = 0.01f;
+
+    switch (segment)
+    {
+    case SCENARIO_IDLE:
+        // Engine at ~720 rpm
+        r.z += 0.01f * sinf(TWO_PI * 12.0f * t);
+        noise = 0.005f;
+        break;
+    case SCENARIO_CITY:
+        add_city(&r, t);
+        noise = 0.03f;
+        break;
+    case SCENARIO_HIGHWAY:
+        r.y += 0.05f * sinf(TWO_PI * t / 30.0f);
+        r.x += 0.05f * sinf(TWO_PI * t / 20.0f);
+        r.z += 0.02f * sinf(TWO_PI * 8.0f * t);
+        noise = 0.02f;
+        break;
+    case SCENARIO_POTHOLE:
+        // Drop into the hole, then the suspension rings down
+        r.z += peak * sinf(TWO_PI * 2.5f * phase) * expf(-4.0f * phase);
+#if SENSOR_GYRO_ENABLED
+        r.gx = 20.0f * (r.z - GRAVITY_G);
+#endif
+        noise = 0.05f;
+        break;
+    case SCENARIO_HARSH_BRAKING:
+        add_city(&r, t);
+        r.y += peak * envelope(phase);
+        break;
+    case SCENARIO_CORNERING:
+        r.x += peak * sinf((float)M_PI * phase);
+        r.y -= 0.1f * fabsf(r.x);
+        noise = 0.02f;
+        break;
+    case SCENARIO_CRASH:
+        // One half-sine impact, then the vehicle sits still
+        if (elapsed_us < CRASH_IMPULSE_US)
+        {
+            float shock = peak * sinf((float)M_PI * elapsed_us / CRASH_IMPULSE_US);
+            r.x += shock * sinf(heading);
+            r.y += shock * cosf(heading);
+            r.z += 0.3f * shock * rng_gaussian();
+            noise = 0.2f;
+        }
+        else
+        {
+            noise = 0.002f;
+        }
+        break;
+    case SCENARIO_SENSOR_FAULT:
+        switch (fault)
+        {
+        case FAULT_STUCK:
+            last.timestamp_us = r.timestamp_us;
+            return last;
+        case FAULT_SATURATED:
+            add_city(&r, t);
+            r.y = peak;
+            break;
+        case FAULT_DROPOUT:
+            return (synth_t){.timestamp_us = r.timestamp_us};
+        case FAULT_SPIKES:
+            add_city(&r, t);
+            if (rng_next() % 20 == 0)
+                r.x = peak;
+            break;
+        default:
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+
+    r.x = clamp_range(r.x + noise * rng_gaussian());
+    r.y = clamp_range(r.y + noise * rng_gaussian());
+    r.z = clamp_range(r.z + noise * rng_gaussian());
+#if SENSOR_GYRO_ENABLED
+    r.gz += YAW_DPS_PER_G * r.x;
+    if (segment == SCENARIO_CRASH && elapsed_us < CRASH_IMPULSE_US)
+        r.gz += GYRO_LIMIT_DPS * rng_gaussian();
+    r.gx = fmaxf(-GYRO_LIMIT_DPS, fminf(GYRO_LIMIT_DPS, r.gx + noise * 10.0f * rng_gaussian()));
+    r.gy = fmaxf(-GYRO_LIMIT_DPS, fminf(GYRO_LIMIT_DPS, r.gy + noise * 10.0f * rng_gaussian()));
+    r.gz = fmaxf(-GYRO_LIMIT_DPS, fminf(GYRO_LIMIT_DPS, r.gz));
+#endif
+    return r;
+}
+
+void scenario_init(uint32_t seed, const uint8_t segment_weights[SCENARIO_COUNT])
+{
+    rng_state = seed ? seed : 1; // xorshift never leaves zero
+    weight_total = 0;
+    for (int i = 0; i < SCENARIO_COUNT; i++)
+    {
+        weights[i] = segment_weights[i];
+        weight_total += segment_weights[i];
+    }
+    time_us = 0;
+    last = (synth_t){.z = GRAVITY_G};
+    start_segment();
+}
+
+void scenario_configure(uint16_t sample_rate_hz, uint8_t accel_range_g)
+{
+    period_us = 1000000 / sample_rate_hz;
+    range_g = accel_range_g;
+}
+
+sensor_reading_t scenario_next(void)
+{
+    if (time_us - segment_start_us >= segment_duration_us)
+        start_segment();
+
+    synth_t r = synthesize();
+    last = r;
+    time_us += period_us;
+    return (sensor_reading_t){
+        .x = accel_from_g(r.x),
+        .y = accel_from_g(r.y),
+        .z = accel_from_g(r.z),
+#if SENSOR_GYRO_ENABLED
+        .gx = r.gx,
+        .gy = r.gy,
+        .gz = r.gz,
+#endif
+        .timestamp_us = r.timestamp_us,
+    };
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "message_types.h"
+#include <stdint.h>
+
+// Synthetic drive for MOCK_SENSOR_DATA: a seeded random sequence of segments,
+// each picked with the relative weight given to scenario_init()
+typedef enum {
+    SCENARIO_IDLE,
+    SCENARIO_CITY,
+    SCENARIO_HIGHWAY,
+    SCENARIO_POTHOLE,
+    SCENARIO_HARSH_BRAKING,
+    SCENARIO_CORNERING,
+    SCENARIO_CRASH,
+    SCENARIO_SENSOR_FAULT,
+    SCENARIO_COUNT
+} scenario_segment_t;
+
+// The same seed and weights always produce the same drive
+void scenario_init(uint32_t seed, const uint8_t weights[SCENARIO_COUNT]);
+
+// Sample spacing and the range faults saturate at; follows the sensor config
+void scenario_configure(uint16_t sample_rate_hz, uint8_t accel_range_g);
+
+// Next sample, timestamped on the simulated timeline
+sensor_reading_t scenario_next(void);
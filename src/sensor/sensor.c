@@ -1,67 +1,637 @@
 #include "sensor.h"
+#include "replay.h"
+#include "scenario.h"
+#include "calibration.h"
 #include "periph/i2c/i2c_bus.h"
 #include "periph/i2c/mpu6050/mpu6050.h"
 #include "config.h"
 #include "message_types.h"
 #include "queue/ring_buffer.h"
-#include "queue/ring_buffer_utils.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "trace/trace.h"
 #include "watchdog/watchdog.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
 #include <math.h>
 
 static const char *TAG = "sensor";
 
-#ifdef MOCK_SENSOR_DATA
-#define MOCK_LATERAL_AMPLITUDE 0.1f
-#define MOCK_FORWARD_AMPLITUDE 0.2f
-#define MOCK_GRAVITY_BASE 1.0f
-#define MOCK_GRAVITY_VARIATION 0.05f
-#define MOCK_BRAKE_EVENT_TICKS 500
-#define MOCK_BRAKE_FORCE -2.0f
+// Simulated sources have no bus, FIFO or INT pin; they are always polled
+#if defined(MOCK_SENSOR_DATA) || defined(REPLAY_SENSOR_DATA)
+#define SENSOR_SIMULATED 1
+#else
+#define SENSOR_SIMULATED 0
+#endif
+
+_Static_assert(SENSOR_SAMPLES_PER_PERIOD >= 1, "REPLAY_SPEED and MOCK_SPEED start at 1");
 
-static sensor_reading_t read_mock_imu(void);
+#if SENSOR_SIMULATED
+#define SENSOR_USE_DATA_READY 0
+#define SENSOR_USE_FIFO 0
+#elif SENSOR_DATA_READY_ENABLED
+#define SENSOR_USE_DATA_READY 1
+#define SENSOR_USE_FIFO 0
+#else
+#define SENSOR_USE_DATA_READY 0
+#define SENSOR_USE_FIFO SENSOR_FIFO_ENABLED
 #endif
 
-esp_err_t sensor_i2c_init(void)
+// Only the FIFO keeps up with the raw rate
+#define SENSOR_OVERSAMPLE (SENSOR_USE_FIFO && IMU_OVERSAMPLE_ENABLED)
+// Neither FIFO nor interrupt: sensor_task reads once per vTaskDelayUntil
+#define SENSOR_POLLED (!SENSOR_USE_FIFO && !SENSOR_USE_DATA_READY)
+
+#if SENSOR_GYRO_ENABLED
+static volatile float latest_temperature_c = 0.0f;
+
+float sensor_get_temperature_c(void)
+{
+    return latest_temperature_c;
+}
+#endif
+
+// One sample as the driver returns it. Fixed-point builds take the raw
+// counts and scale them to Q10 in integers; the rest have the driver decode
+// to g. Either way calibration_apply then rotates the sample into vehicle
+// axes, so telemetry's counts are rounded from that, not the driver's own.
+#if DETECTOR_FIXED_POINT
+typedef mpu6050_counts_t imu_frame_t;
+#define imu_fifo_read mpu6050_fifo_read_counts
+
+static sensor_reading_t reading_from_frame(const imu_frame_t *f, uint32_t timestamp_us,
+                                           uint8_t range_g)
+{
+    int32_t lsb_per_g = sensor_accel_lsb_per_g(range_g);
+    sensor_reading_t r = {
+        .x = accel_from_counts(f->accel[0], lsb_per_g),
+        .y = accel_from_counts(f->accel[1], lsb_per_g),
+        .z = accel_from_counts(f->accel[2], lsb_per_g),
+        .timestamp_us = timestamp_us,
+        .accel_range_g = range_g};
+#if SENSOR_GYRO_ENABLED
+    // Off the detector path, so these stay in floats
+    latest_temperature_c = f->temp / MPU6050_TEMP_SCALE + MPU6050_TEMP_OFFSET;
+    r.gx = f->gyro[0] / MPU6050_GYRO_SCALE;
+    r.gy = f->gyro[1] / MPU6050_GYRO_SCALE;
+    r.gz = f->gyro[2] / MPU6050_GYRO_SCALE;
+#endif
+    calibration_apply(&r);
+    return r;
+}
+#elif SENSOR_GYRO_ENABLED
+typedef mpu6050_motion_t imu_frame_t;
+#define imu_fifo_read mpu6050_fifo_read_motion
+
+static sensor_reading_t reading_from_frame(const imu_frame_t *f, uint32_t timestamp_us,
+                                           uint8_t range_g)
+{
+    latest_temperature_c = f->temp_c;
+    sensor_reading_t r = {
+        .x = f->accel.x,
+        .y = f->accel.y,
+        .z = f->accel.z,
+        .gx = f->gyro.x,
+        .gy = f->gyro.y,
+        .gz = f->gyro.z,
+        .timestamp_us = timestamp_us,
+        .accel_range_g = range_g};
+    calibration_apply(&r);
+    return r;
+}
+#else
+typedef mpu6050_accel_t imu_frame_t;
+#define imu_fifo_read mpu6050_fifo_read_accel
+
+static sensor_reading_t reading_from_frame(const imu_frame_t *f, uint32_t timestamp_us,
+                                           uint8_t range_g)
+{
+    sensor_reading_t r = {
+        .x = f->x, .y = f->y, .z = f->z, .timestamp_us = timestamp_us, .accel_range_g = range_g};
+    calibration_apply(&r);
+    return r;
+}
+#endif
+
+// Written by sensor_task, read by the trace stats task
+static portMUX_TYPE timing_lock = portMUX_INITIALIZER_UNLOCKED;
+static sensor_timing_stats_t timing;
+static float timing_m2; // Welford sum of squared deviations
+static uint32_t last_timestamp_us;
+static bool have_last_timestamp = false;
+#if SENSOR_USE_FIFO
+// Timestamp given to the newest frame handed out so far
+static uint32_t fifo_last_us;
+static bool have_fifo_last = false;
+#endif
+
+static void record_sample_time(uint32_t timestamp_us)
+{
+    if (!have_last_timestamp)
+    {
+        last_timestamp_us = timestamp_us;
+        have_last_timestamp = true;
+        return;
+    }
+    uint32_t period = timestamp_us - last_timestamp_us; // Wrap-safe
+    last_timestamp_us = timestamp_us;
+
+    taskENTER_CRITICAL(&timing_lock);
+    if (timing.periods == 0 || period < timing.min_period_us)
+        timing.min_period_us = period;
+    if (period > timing.max_period_us)
+        timing.max_period_us = period;
+    timing.periods++;
+    float delta = period - timing.mean_period_us;
+    timing.mean_period_us += delta / timing.periods;
+    timing_m2 += delta * (period - timing.mean_period_us);
+    taskEXIT_CRITICAL(&timing_lock);
+}
+
+bool sensor_get_timing_stats(sensor_timing_stats_t *stats)
+{
+    taskENTER_CRITICAL(&timing_lock);
+    *stats = timing;
+    float m2 = timing_m2;
+    taskEXIT_CRITICAL(&timing_lock);
+
+    if (stats->periods == 0)
+        return false;
+    stats->stddev_us = sqrtf(m2 / stats->periods);
+    return true;
+}
+
+#if !SENSOR_USE_FIFO
+// The sample is gone; nothing is pushed in its place
+static void record_read_error(void)
+{
+    taskENTER_CRITICAL(&timing_lock);
+    timing.read_errors++;
+    taskEXIT_CRITICAL(&timing_lock);
+}
+#endif
+
+void sensor_reset_timing_stats(void)
 {
-#ifdef MOCK_SENSOR_DATA
+    taskENTER_CRITICAL(&timing_lock);
+    timing = (sensor_timing_stats_t){0};
+    timing_m2 = 0.0f;
+    taskEXIT_CRITICAL(&timing_lock);
+}
+
+// Settings in effect. sensor_task owns the bus, so it is the only task that
+// applies them; others queue a change in pending_config.
+static portMUX_TYPE config_lock = portMUX_INITIALIZER_UNLOCKED;
+static sensor_config_t active_config = {
+    .sample_rate_hz = IMU_SAMPLE_RATE_HZ,
+    .accel_range_g = IMU_ACCEL_RANGE_G,
+    .dlpf_hz = IMU_DLPF_HZ,
+};
+static uint8_t active_oversample = 1;
+static sensor_config_t pending_config;
+static bool config_pending = false;
+static uint32_t sample_period_us = 1000000 / IMU_SAMPLE_RATE_HZ; // Raw; sensor_task only
+#if SENSOR_POLLED
+static TickType_t poll_period_ticks = 1; // sensor_task only
+#endif
+
+#if SENSOR_OVERSAMPLE
+// Largest factor whose raw rate the MPU6050 hits exactly (1 kHz / n), so the
+// output rate stays the one asked for
+static uint8_t pick_oversample(uint16_t rate_hz)
+{
+    for (uint8_t factor = IMU_OVERSAMPLE_MAX; factor > 1; factor--)
+    {
+        uint32_t raw_hz = (uint32_t)rate_hz * factor;
+        if (raw_hz <= IMU_RAW_RATE_MAX_HZ && IMU_RAW_RATE_MAX_HZ % raw_hz == 0)
+            return factor;
+    }
+    return 1;
+}
+#endif
+
+static const struct
+{
+    uint16_t hz;
+    mpu6050_dlpf_t dlpf;
+} dlpf_bandwidths[] = {
+    {184, MPU6050_DLPF_184HZ}, {94, MPU6050_DLPF_94HZ}, {44, MPU6050_DLPF_44HZ},
+    {21, MPU6050_DLPF_21HZ},   {10, MPU6050_DLPF_10HZ}, {5, MPU6050_DLPF_5HZ},
+};
+
+// Bandwidths round down, so the filter never lets through more than asked
+static mpu6050_dlpf_t dlpf_at_most(uint16_t hz)
+{
+    for (size_t i = 0; i < sizeof(dlpf_bandwidths) / sizeof(dlpf_bandwidths[0]); i++)
+    {
+        if (dlpf_bandwidths[i].hz <= hz)
+            return dlpf_bandwidths[i].dlpf;
+    }
+    return MPU6050_DLPF_5HZ;
+}
+
+static esp_err_t to_driver_config(const sensor_config_t *config, mpu6050_config_t *out)
+{
+    if (config->sample_rate_hz < IMU_SAMPLE_RATE_MIN_HZ ||
+        config->sample_rate_hz > IMU_SAMPLE_RATE_MAX_HZ)
+        return ESP_ERR_INVALID_ARG;
+    out->sample_rate_hz = config->sample_rate_hz;
+
+    switch (config->accel_range_g)
+    {
+    case 2:
+        out->accel_range = MPU6050_RANGE_2G;
+        break;
+    case 4:
+        out->accel_range = MPU6050_RANGE_4G;
+        break;
+    case 8:
+        out->accel_range = MPU6050_RANGE_8G;
+        break;
+    case 16:
+        out->accel_range = MPU6050_RANGE_16G;
+        break;
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    out->dlpf = config->dlpf_hz == 0 ? MPU6050_DLPF_OFF : dlpf_at_most(config->dlpf_hz);
     return ESP_OK;
+}
+
+static uint16_t dlpf_to_hz(mpu6050_dlpf_t dlpf)
+{
+    for (size_t i = 0; i < sizeof(dlpf_bandwidths) / sizeof(dlpf_bandwidths[0]); i++)
+    {
+        if (dlpf_bandwidths[i].dlpf == dlpf)
+            return dlpf_bandwidths[i].hz;
+    }
+    return 0;
+}
+
+#if SENSOR_POLLED
+// Polling waits whole ticks, so it runs at the tick rate divided by a whole
+// number. Returns the nearest such rate, or 0 if hz is above the tick rate.
+static uint16_t polled_rate_hz(uint16_t hz)
+{
+    if (hz > configTICK_RATE_HZ)
+    {
+        ESP_LOGE(TAG, "Polling cannot sample at %u Hz with a %u Hz tick", hz,
+                 (unsigned)configTICK_RATE_HZ);
+        return 0;
+    }
+    uint32_t ticks = (configTICK_RATE_HZ + hz / 2) / hz;
+    return configTICK_RATE_HZ / ticks;
+}
+#endif
+
+// Runs on sensor_task
+static esp_err_t apply_config(const sensor_config_t *config)
+{
+    mpu6050_config_t driver_config;
+    esp_err_t ret = to_driver_config(config, &driver_config);
+    if (ret != ESP_OK)
+        return ret;
+
+    sensor_config_t applied = {
+        .sample_rate_hz = config->sample_rate_hz,
+        .accel_range_g = config->accel_range_g,
+        .dlpf_hz = dlpf_to_hz(driver_config.dlpf),
+    };
+#ifdef REPLAY_SENSOR_DATA
+    // Playback speed is REPLAY_SPEED; rate and range belong to the recording
+    applied.sample_rate_hz = replay_sample_rate_hz();
+    applied.accel_range_g = replay_accel_range_g();
+#endif
+#if SENSOR_POLLED
+    uint16_t polled_hz = polled_rate_hz(applied.sample_rate_hz);
+    if (polled_hz == 0)
+        return ESP_ERR_INVALID_ARG;
+#ifndef REPLAY_SENSOR_DATA
+    applied.sample_rate_hz = polled_hz;
+    driver_config.sample_rate_hz = polled_hz;
+#endif
+#endif
+#if defined(MOCK_SENSOR_DATA) && !defined(REPLAY_SENSOR_DATA)
+    scenario_configure(applied.sample_rate_hz, applied.accel_range_g);
+#endif
+    uint8_t oversample = 1;
+#if SENSOR_OVERSAMPLE
+    oversample = pick_oversample(applied.sample_rate_hz);
+    driver_config.sample_rate_hz = applied.sample_rate_hz * oversample;
+    // IMU_DLPF_HZ is left open for the decimator. Without one (rates that
+    // don't divide 1 kHz) the DLPF is the only anti-alias filter, so it must
+    // close below the output Nyquist frequency.
+    if (oversample == 1)
+    {
+        uint16_t nyquist_hz = applied.sample_rate_hz / 2;
+        if (driver_config.dlpf == MPU6050_DLPF_OFF || dlpf_to_hz(driver_config.dlpf) > nyquist_hz)
+        {
+            driver_config.dlpf = dlpf_at_most(nyquist_hz);
+            applied.dlpf_hz = dlpf_to_hz(driver_config.dlpf);
+        }
+    }
+#endif
+#if !SENSOR_SIMULATED
+    uint16_t raw_hz;
+    ret = mpu6050_configure(&driver_config, &raw_hz);
+    if (ret != ESP_OK)
+        return ret;
+    applied.sample_rate_hz = raw_hz / oversample;
+#endif
+
+    taskENTER_CRITICAL(&config_lock);
+    active_config = applied;
+    active_oversample = oversample;
+    taskEXIT_CRITICAL(&config_lock);
+    sample_period_us = 1000000 / (applied.sample_rate_hz * oversample);
+#if SENSOR_POLLED
+    poll_period_ticks = (configTICK_RATE_HZ + applied.sample_rate_hz / 2) / applied.sample_rate_hz;
 #endif
+
+#if !SENSOR_SIMULATED
+    // A stuck transaction may cost one sample (or one FIFO wakeup), never more
+#if SENSOR_USE_FIFO
+    i2c_bus_set_timeout_ms(SENSOR_FIFO_READ_INTERVAL_MS);
+#else
+    i2c_bus_set_timeout_ms(sample_period_us / 1000);
+#endif
+#endif
+
+    // Periods from the old rate would swamp the new statistics
+    have_last_timestamp = false;
+#if SENSOR_USE_FIFO
+    have_fifo_last = false;
+#endif
+    sensor_reset_timing_stats();
+    return ESP_OK;
+}
+
+static void apply_pending_config(void)
+{
+    taskENTER_CRITICAL(&config_lock);
+    bool pending = config_pending;
+    sensor_config_t config = pending_config;
+    config_pending = false;
+    taskEXIT_CRITICAL(&config_lock);
+
+    if (!pending)
+        return;
+
+    esp_err_t ret = apply_config(&config);
+    if (ret != ESP_OK)
+        ESP_LOGE(TAG, "Failed to apply IMU config: %s", esp_err_to_name(ret));
+    else
+        ESP_LOGI(TAG, "IMU config: %u Hz (x%u oversampled), +-%u g, dlpf %u Hz",
+                 active_config.sample_rate_hz, active_oversample, active_config.accel_range_g,
+                 active_config.dlpf_hz);
+}
+
+esp_err_t sensor_set_config(const sensor_config_t *config)
+{
+    mpu6050_config_t unused;
+    esp_err_t ret = to_driver_config(config, &unused);
+    if (ret != ESP_OK)
+        return ret;
+
+    taskENTER_CRITICAL(&config_lock);
+    pending_config = *config;
+    config_pending = true;
+    taskEXIT_CRITICAL(&config_lock);
+    return ESP_OK;
+}
+
+void sensor_get_config(sensor_config_t *config)
+{
+    taskENTER_CRITICAL(&config_lock);
+    *config = active_config;
+    taskEXIT_CRITICAL(&config_lock);
+}
+
+uint16_t sensor_get_sample_rate_hz(void)
+{
+    sensor_config_t config;
+    sensor_get_config(&config);
+    return config.sample_rate_hz;
+}
+
+uint8_t sensor_get_oversample(void)
+{
+    taskENTER_CRITICAL(&config_lock);
+    uint8_t oversample = active_oversample;
+    taskEXIT_CRITICAL(&config_lock);
+    return oversample;
+}
+
+uint16_t sensor_accel_lsb_per_g(uint8_t range_g)
+{
+    return (uint16_t)((uint32_t)MPU6050_ACCEL_SCALE_2G * 2 / range_g);
+}
+
+float sensor_get_accel_lsb_per_g(void)
+{
+    sensor_config_t config;
+    sensor_get_config(&config);
+    return sensor_accel_lsb_per_g(config.accel_range_g);
+}
+
+#if SENSOR_GYRO_ENABLED
+float sensor_get_gyro_lsb_per_dps(void)
+{
+    return MPU6050_GYRO_SCALE;
+}
+#endif
+
+esp_err_t sensor_i2c_init(void)
+{
+#if defined(REPLAY_SENSOR_DATA)
+    esp_err_t ret = replay_init();
+    if (ret == ESP_OK)
+        ret = apply_config(&active_config);
+    return ret;
+#elif defined(MOCK_SENSOR_DATA)
+    static const uint8_t weights[SCENARIO_COUNT] = MOCK_SCENARIO_WEIGHTS;
+    scenario_init(MOCK_SCENARIO_SEED, weights);
+    return apply_config(&active_config);
+#else
     ESP_ERROR_CHECK(i2c_bus_init());
-    return mpu6050_init();
+    esp_err_t ret = calibration_init();
+    if (ret == ESP_OK)
+        ret = mpu6050_init();
+    if (ret == ESP_OK)
+        ret = apply_config(&active_config);
+#if SENSOR_USE_DATA_READY
+    if (ret == ESP_OK)
+        ret = mpu6050_data_ready_init();
+#elif SENSOR_USE_FIFO
+    if (ret == ESP_OK)
+        ret = mpu6050_fifo_init(SENSOR_GYRO_ENABLED);
+#endif
+    return ret;
+#endif
 }
 
-sensor_reading_t read_imu(void)
+esp_err_t read_imu(sensor_reading_t *out)
 {
-#ifndef MOCK_SENSOR_DATA
-    float ax, ay, az;
-    mpu6050_read_accel(&ax, &ay, &az);
-    return (sensor_reading_t){ax, ay, az};
+#if SENSOR_SIMULATED
+#if defined(REPLAY_SENSOR_DATA)
+    *out = replay_next();
 #else
-    return read_mock_imu();
+    *out = scenario_next();
+#endif
+    out->accel_range_g = active_config.accel_range_g;
+    return ESP_OK;
+#else
+    imu_frame_t frame;
+    uint32_t now = (uint32_t)esp_timer_get_time();
+#if DETECTOR_FIXED_POINT
+    esp_err_t ret = mpu6050_read_counts(&frame, SENSOR_GYRO_ENABLED);
+#elif SENSOR_GYRO_ENABLED
+    esp_err_t ret = mpu6050_read_motion(&frame);
+#else
+    esp_err_t ret = mpu6050_read_accel(&frame.x, &frame.y, &frame.z);
+#endif
+    if (ret != ESP_OK)
+        return ret;
+    *out = reading_from_frame(&frame, now, active_config.accel_range_g);
+    return ESP_OK;
 #endif
 }
 
-#ifdef MOCK_SENSOR_DATA
-static sensor_reading_t read_mock_imu(void)
+#if SENSOR_USE_FIFO
+// The FIFO carries no timestamps, so they are reconstructed at the sensor
+// rate. A burst cut at SENSOR_FIFO_BURST_MAX leaves newer frames behind, so
+// it continues from the previous burst. A burst that drained the FIFO ends
+// now: it starts a period after the previous one, or later if frames were
+// lost. If that would go back in time (the sensor clock runs ahead of ours),
+// its frames are spread evenly up to now instead. Timestamps never decrease.
+static uint32_t fifo_frame_time(size_t i, size_t count, bool drained, uint32_t now)
 {
-    static uint32_t tick = 0;
-    tick++;
+    uint32_t back = now - (uint32_t)(count - 1 - i) * sample_period_us;
+    if (!have_fifo_last)
+        return back;
+    // Also when the previous burst already ran past now
+    if (!drained || (int32_t)(now - fifo_last_us) <= 0)
+        return fifo_last_us + (uint32_t)(i + 1) * sample_period_us;
 
-    sensor_reading_t r = {
-        .x = MOCK_LATERAL_AMPLITUDE * sinf(tick * 0.05f),
-        .y = MOCK_FORWARD_AMPLITUDE * sinf(tick * 0.02f),
-        .z = MOCK_GRAVITY_BASE + MOCK_GRAVITY_VARIATION * sinf(tick * 0.1f)};
+    uint32_t first_back = now - (uint32_t)(count - 1) * sample_period_us;
+    if ((int32_t)(first_back - fifo_last_us) >= (int32_t)sample_period_us)
+        return back;
+    uint32_t span = now - fifo_last_us; // Wrap-safe
+    return fifo_last_us + (uint32_t)((uint64_t)span * (i + 1) / count);
+}
+
+// Moves everything the MPU6050 has sampled since the last call into sensor_rb.
+// The timestamps are reconstructed, not measured, so they stay out of the
+// sample timing stats.
+static void read_fifo_burst(void)
+{
+    static imu_frame_t burst[SENSOR_FIFO_BURST_MAX];
+    static sensor_reading_t readings[SENSOR_FIFO_BURST_MAX];
 
-    if (tick % MOCK_BRAKE_EVENT_TICKS == 0)
+    size_t count = 0;
+    if (imu_fifo_read(burst, SENSOR_FIFO_BURST_MAX, &count) != ESP_OK)
     {
-        r.y = -DEFAULT_HARSH_BRAKING_THRESHOLD_G - 1.0f;
-        ESP_LOGI(TAG, "Mock brake event");
+        // An overflow reset the FIFO, so what follows is not contiguous
+        have_fifo_last = false;
+        return;
     }
-    return r;
+    if (count == 0)
+        return;
+
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    bool drained = count < SENSOR_FIFO_BURST_MAX;
+    for (size_t i = 0; i < count; i++)
+    {
+        readings[i] = reading_from_frame(&burst[i], fifo_frame_time(i, count, drained, now),
+                                         active_config.accel_range_g);
+#if LOG_SENSOR_DATA
+        ESP_LOGI(TAG, "x: %.2f y: %.2f z: %.2f", accel_to_g(readings[i].x),
+                 accel_to_g(readings[i].y), accel_to_g(readings[i].z));
+#endif
+    }
+    fifo_last_us = readings[count - 1].timestamp_us;
+    have_fifo_last = true;
+
+    size_t pushed = ring_buffer_push_back_n(sensor_rb, readings, count, NULL);
+    if (pushed < count)
+        ESP_LOGW(TAG, "sensor_rb full, dropped %u sensor readings", (unsigned)(count - pushed));
+}
+#endif
+
+#if SENSOR_USE_DATA_READY
+static TaskHandle_t sensor_task_handle = NULL;
+static volatile uint32_t data_ready_time_us;
+
+static void IRAM_ATTR data_ready_isr(void *arg)
+{
+    (void)arg;
+    data_ready_time_us = (uint32_t)esp_timer_get_time();
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(sensor_task_handle, &woken);
+    if (woken)
+        portYIELD_FROM_ISR();
+}
+
+// The ISR notifies the calling task, so this runs from sensor_task itself
+static esp_err_t data_ready_start(void)
+{
+    sensor_task_handle = xTaskGetCurrentTaskHandle();
+
+    const gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << SENSOR_DATA_READY_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,
+        .intr_type = GPIO_INTR_POSEDGE,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK)
+        return ret;
+
+    // Another driver may have installed the service already
+    ret = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE)
+        return ret;
+
+    return gpio_isr_handler_add(SENSOR_DATA_READY_GPIO, data_ready_isr, NULL);
+}
+
+// Reads the sample whose interrupt woke us, stamped with the interrupt time
+static void read_data_ready_sample(void)
+{
+    uint32_t pending = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SENSOR_DATA_READY_TIMEOUT_MS));
+    if (pending == 0)
+    {
+        ESP_LOGW(TAG, "No data ready interrupt in %d ms", SENSOR_DATA_READY_TIMEOUT_MS);
+        return;
+    }
+
+    // The data registers only hold the latest sample; earlier ones are gone
+    if (pending > 1)
+    {
+        taskENTER_CRITICAL(&timing_lock);
+        timing.missed += pending - 1;
+        taskEXIT_CRITICAL(&timing_lock);
+    }
+
+    sensor_reading_t r;
+    if (read_imu(&r) != ESP_OK)
+    {
+        record_read_error();
+        return;
+    }
+    r.timestamp_us = data_ready_time_us;
+    record_sample_time(r.timestamp_us);
+
+#if LOG_SENSOR_DATA
+    ESP_LOGI(TAG, "x: %.2f y: %.2f z: %.2f", accel_to_g(r.x), accel_to_g(r.y), accel_to_g(r.z));
+#endif
+
+    if (!ring_buffer_push_back(sensor_rb, &r, NULL))
+        ESP_LOGW(TAG, "sensor_rb full, dropped sensor reading");
 }
 #endif
 
@@ -70,23 +640,48 @@ void sensor_task(void *pvParameters)
     ESP_LOGI(TAG, "Sensor task running");
     watchdog_register_task();
 
+#if SENSOR_USE_DATA_READY
+    ESP_ERROR_CHECK(data_ready_start());
+#elif !SENSOR_USE_FIFO
+    // Delay to the next period boundary, not for a period after the read,
+    // so read time and scheduling latency do not add up into drift
+    TickType_t last_wake = xTaskGetTickCount();
+#endif
+
     while (1)
     {
         TRACE_TASK_RUN(TAG);
         watchdog_feed();
+        apply_pending_config();
 
-        sensor_reading_t r = read_imu();
+#if SENSOR_USE_DATA_READY
+        read_data_ready_sample();
+#elif SENSOR_USE_FIFO
+        read_fifo_burst();
+        vTaskDelay(pdMS_TO_TICKS(SENSOR_FIFO_READ_INTERVAL_MS));
+#else
+        for (int i = 0; i < SENSOR_SAMPLES_PER_PERIOD; i++)
+        {
+            sensor_reading_t r;
+            if (read_imu(&r) != ESP_OK)
+            {
+                record_read_error();
+                continue;
+            }
+            record_sample_time(r.timestamp_us);
 
 #if LOG_SENSOR_DATA
-        ESP_LOGI(TAG, "x: %.2f", r.x);
-        ESP_LOGI(TAG, "y: %.2f", r.y);
-        ESP_LOGI(TAG, "z: %.2f", r.z);
+            ESP_LOGI(TAG, "x: %.2f", accel_to_g(r.x));
+            ESP_LOGI(TAG, "y: %.2f", accel_to_g(r.y));
+            ESP_LOGI(TAG, "z: %.2f", accel_to_g(r.z));
 #endif
 
-        if (!ring_buffer_push_back_with_full_log(sensor_rb, &r,
-                                                 "sensor_rb full, overwrote oldest reading"))
-            ESP_LOGW(TAG, "sensor_rb: failed to push sensor reading");
+            if (!ring_buffer_push_back(sensor_rb, &r, NULL))
+                ESP_LOGW(TAG, "sensor_rb full, dropped sensor reading");
+        }
 
-        vTaskDelay(pdMS_TO_TICKS(SENSOR_INTERVAL_MS));
+        // apply_config keeps the rate at a whole number of ticks
+        vTaskDelayUntil(&last_wake, poll_period_ticks);
+#endif
     }
 }
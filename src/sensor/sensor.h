@@ -1,7 +1,54 @@
 #pragma once
 #include "message_types.h"
 #include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Spacing between consecutive sample timestamps, since boot or the last reset.
+// Not collected in FIFO mode, whose timestamps are reconstructed.
+typedef struct {
+    uint32_t periods;       // Intervals measured
+    uint32_t missed;        // Data ready interrupts not serviced in time
+    uint32_t read_errors;   // Samples lost to failed reads
+    uint32_t min_period_us;
+    uint32_t max_period_us;
+    float mean_period_us;
+    float stddev_us;
+} sensor_timing_stats_t;
+
+// IMU settings in physical units
+typedef struct {
+    uint16_t sample_rate_hz; // IMU_SAMPLE_RATE_MIN_HZ to IMU_SAMPLE_RATE_MAX_HZ
+    uint8_t accel_range_g;   // 2, 4, 8 or 16
+    uint16_t dlpf_hz;        // 0 = off, else rounded down to 184/94/44/21/10/5
+} sensor_config_t;
 
 esp_err_t sensor_i2c_init(void);
-sensor_reading_t read_imu(void);
+// Reads one sample into *out. On error *out is left alone and nothing was read.
+esp_err_t read_imu(sensor_reading_t *out);
 void sensor_task(void *pvParameters);
+
+#if SENSOR_GYRO_ENABLED
+// Die temperature from the most recent sample
+float sensor_get_temperature_c(void);
+#endif
+
+// Validates config and hands it to sensor_task, which applies it before its
+// next read. Readings from then on use the new rate and range.
+esp_err_t sensor_set_config(const sensor_config_t *config);
+// Settings in effect; the rate is the one the sensor actually produces
+void sensor_get_config(sensor_config_t *config);
+uint16_t sensor_get_sample_rate_hz(void);
+// Raw samples in sensor_rb per sample at sensor_get_sample_rate_hz(); the
+// processing task decimates by this
+uint8_t sensor_get_oversample(void);
+// Raw counts per unit at the range in effect
+float sensor_get_accel_lsb_per_g(void);
+uint16_t sensor_accel_lsb_per_g(uint8_t range_g);
+#if SENSOR_GYRO_ENABLED
+float sensor_get_gyro_lsb_per_dps(void);
+#endif
+
+// Returns false until two samples have been taken
+bool sensor_get_timing_stats(sensor_timing_stats_t *stats);
+void sensor_reset_timing_stats(void);
@@ -0,0 +1,318 @@
+#include "benchmark.h"
+#include "config.h"
+#include "message_types.h"
+#include "queue/ring_buffer.h"
+#include "benchmark_typed.h"
+#include "processing/detector_defs.h"
+#include "processing/biquad.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <math.h>
+
+static const char *TAG = "bench";
+
+#if TRACE_BENCHMARKS_ENABLED
+
+#define BENCH_ROUNDS 1000
+
+// Fills the buffer to capacity and drains it again, timing both halves, so
+// every push and pop takes the same path it would in the running system.
+// Bulk mode moves the whole fill in one push_back_n/pop_front_n call.
+static void run_ring_buffer(const char *label, ring_buffer_t *rb, bool bulk)
+{
+    sensor_reading_t in[SENSOR_QUEUE_SIZE] = {0};
+    sensor_reading_t out[SENSOR_QUEUE_SIZE];
+    int64_t push_us = 0;
+    int64_t pop_us = 0;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        int64_t start = esp_timer_get_time();
+        if (bulk)
+            ring_buffer_push_back_n(rb, in, SENSOR_QUEUE_SIZE, NULL);
+        else
+            for (int i = 0; i < SENSOR_QUEUE_SIZE; i++)
+                ring_buffer_push_back(rb, &in[i], NULL);
+        int64_t mid = esp_timer_get_time();
+        if (bulk)
+            ring_buffer_pop_front_n(rb, out, SENSOR_QUEUE_SIZE);
+        else
+            for (int i = 0; i < SENSOR_QUEUE_SIZE; i++)
+                ring_buffer_pop_front(rb, &out[i]);
+        push_us += mid - start;
+        pop_us += esp_timer_get_time() - mid;
+    }
+
+    int64_t ops = (int64_t)BENCH_ROUNDS * SENSOR_QUEUE_SIZE;
+    ESP_LOGI(TAG, "%-16s push %5lld ns  pop %5lld ns  (per item)", label,
+             push_us * 1000 / ops, pop_us * 1000 / ops);
+}
+
+static void bench_ring_buffer(const char *label, ring_buffer_sync_t sync, bool bulk)
+{
+    ring_buffer_t *rb = ring_buffer_create_with_sync(SENSOR_QUEUE_SIZE,
+                                                     sizeof(sensor_reading_t), sync);
+    if (!rb)
+    {
+        ESP_LOGE(TAG, "%s: failed to create ring buffer", label);
+        return;
+    }
+    run_ring_buffer(label, rb, bulk);
+    ring_buffer_destroy(rb);
+}
+
+typedef struct
+{
+    bool (*push_back)(const sensor_reading_t *item, bool *was_full);
+    size_t (*push_back_n)(const sensor_reading_t *items, size_t n, bool *was_full);
+    bool (*pop_front)(sensor_reading_t *item);
+    size_t (*pop_front_n)(sensor_reading_t *items, size_t max_items);
+} typed_ops_t;
+
+static const typed_ops_t typed_mutex_ops = {
+    bench_typed_mutex_push_back, bench_typed_mutex_push_back_n,
+    bench_typed_mutex_pop_front, bench_typed_mutex_pop_front_n};
+
+static const typed_ops_t typed_spsc_ops = {
+    bench_typed_spsc_push_back, bench_typed_spsc_push_back_n,
+    bench_typed_spsc_pop_front, bench_typed_spsc_pop_front_n};
+
+// Same fill/drain pattern as bench_ring_buffer, against a TypedRingBuffer
+// instance reached through its C wrapper
+static void bench_typed(const char *label, const typed_ops_t *ops, bool bulk)
+{
+    sensor_reading_t in[SENSOR_QUEUE_SIZE] = {0};
+    sensor_reading_t out[SENSOR_QUEUE_SIZE];
+    int64_t push_us = 0;
+    int64_t pop_us = 0;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        int64_t start = esp_timer_get_time();
+        if (bulk)
+            ops->push_back_n(in, SENSOR_QUEUE_SIZE, NULL);
+        else
+            for (int i = 0; i < SENSOR_QUEUE_SIZE; i++)
+                ops->push_back(&in[i], NULL);
+        int64_t mid = esp_timer_get_time();
+        if (bulk)
+            ops->pop_front_n(out, SENSOR_QUEUE_SIZE);
+        else
+            for (int i = 0; i < SENSOR_QUEUE_SIZE; i++)
+                ops->pop_front(&out[i]);
+        push_us += mid - start;
+        pop_us += esp_timer_get_time() - mid;
+    }
+
+    int64_t ops_count = (int64_t)BENCH_ROUNDS * SENSOR_QUEUE_SIZE;
+    ESP_LOGI(TAG, "%-16s push %5lld ns  pop %5lld ns  (per item)", label,
+             push_us * 1000 / ops_count, pop_us * 1000 / ops_count);
+}
+
+static void default_thresholds(detector_thresholds_t *th)
+{
+    for (int d = 0; d < DETECTOR_COUNT; d++)
+    {
+        float threshold_g = detectors[d].default_threshold;
+        th->enter[d] = severity_from_g(threshold_g, detectors[d].severity_squared);
+        th->exit[d] = severity_from_g(threshold_g * DETECTOR_EXIT_RATIO,
+                                      detectors[d].severity_squared);
+    }
+}
+
+// The evaluation pass over a quiet block: the path almost every block takes,
+// since the episode state machine only runs where something crosses
+static void bench_detector_kernels(void)
+{
+    static sensor_block_t block;
+    static detector_block_result_t result;
+    detector_thresholds_t thresholds;
+    default_thresholds(&thresholds);
+    for (int i = 0; i < DETECTOR_BLOCK_SIZE; i++)
+    {
+        block.x[i] = block_value_from_g(0.01f * i);
+        block.y[i] = block_value_from_g(-0.01f * i);
+        block.z[i] = block_value_from_g(1.0f);
+        block.timestamp_us[i] = i * 10000;
+    }
+    block.count = DETECTOR_BLOCK_SIZE;
+
+    static const struct
+    {
+        const char *name;
+        detector_stream_t stream;
+    } streams[] = {
+        {"detect full", DETECTOR_STREAM_FULL},
+        {"detect decimated", DETECTOR_STREAM_DECIMATED},
+    };
+    for (size_t s = 0; s < sizeof(streams) / sizeof(streams[0]); s++)
+    {
+        volatile uint32_t sink = 0;
+
+        int64_t start = esp_timer_get_time();
+        for (int round = 0; round < BENCH_ROUNDS; round++)
+        {
+            detector_evaluate_block(&block, streams[s].stream, &thresholds, &result);
+            sink |= result.entered[0];
+        }
+        int64_t us = esp_timer_get_time() - start;
+
+        int64_t samples = (int64_t)BENCH_ROUNDS * DETECTOR_BLOCK_SIZE;
+        ESP_LOGI(TAG, "%-16s %5lld ns  %8lld samples/s  (per sample)", streams[s].name,
+                 us * 1000 / samples, us > 0 ? samples * 1000000 / us : 0);
+    }
+}
+
+// The float detector each signal replaces, with the sqrtf it used to take
+static float reference_value(detector_type_t type, float x, float y, float z)
+{
+    switch (type)
+    {
+    case DETECTOR_CRASH:
+        return sqrtf(x * x + y * y + (z - 1.0f) * (z - 1.0f));
+    case DETECTOR_HARSH_BRAKING:
+        return -y;
+    case DETECTOR_HARSH_ACCEL:
+        return y;
+    case DETECTOR_HARSH_CORNERING:
+        return fabsf(x);
+    default:
+        return 0.0f;
+    }
+}
+
+#if DETECTOR_FIXED_POINT
+#define EQUIVALENCE_TOLERANCE_G (2.0f / DETECTOR_ONE_G) // Rounding of up to 3 axes
+#else
+#define EQUIVALENCE_TOLERANCE_G 1e-4f // Squared compare vs sqrtf
+#endif
+
+// Random readings through the evaluation pass and the float reference. They may only
+// disagree on values within EQUIVALENCE_TOLERANCE_G of the threshold.
+static void check_detector_equivalence(void)
+{
+    static sensor_block_t block;
+    static float x[DETECTOR_BLOCK_SIZE], y[DETECTOR_BLOCK_SIZE], z[DETECTOR_BLOCK_SIZE];
+    static detector_block_result_t result;
+    detector_thresholds_t thresholds;
+    default_thresholds(&thresholds);
+    uint32_t rng = 1;
+
+    for (int d = 0; d < DETECTOR_COUNT; d++)
+    {
+        const detector_config_t *det = &detectors[d];
+        float threshold_g = det->default_threshold;
+        uint32_t boundary = 0, errors = 0;
+
+        for (int round = 0; round < BENCH_ROUNDS; round++)
+        {
+            block.count = 0;
+            for (int i = 0; i < DETECTOR_BLOCK_SIZE; i++)
+            {
+                // xorshift32, spread over +-2x the threshold on every axis
+                float v[3];
+                for (int a = 0; a < 3; a++)
+                {
+                    rng ^= rng << 13;
+                    rng ^= rng >> 17;
+                    rng ^= rng << 5;
+                    v[a] = ((float)rng / UINT32_MAX * 4.0f - 2.0f) * threshold_g;
+                }
+                sensor_reading_t r = {
+                    .x = accel_from_g(v[0]), .y = accel_from_g(v[1]), .z = accel_from_g(v[2])};
+                // The reference sees what the kernel sees, quantized in fixed builds
+                x[i] = accel_to_g(r.x);
+                y[i] = accel_to_g(r.y);
+                z[i] = accel_to_g(r.z);
+                sensor_block_append(&block, &r);
+            }
+
+            detector_evaluate_block(&block, det->stream, &thresholds, &result);
+            uint32_t mask = result.entered[d];
+            for (int i = 0; i < DETECTOR_BLOCK_SIZE; i++)
+            {
+                float value = reference_value(d, x[i], y[i], z[i]);
+                if ((value >= threshold_g) == (bool)(mask >> i & 1))
+                    continue;
+                if (fabsf(value - threshold_g) <= EQUIVALENCE_TOLERANCE_G)
+                    boundary++;
+                else
+                    errors++;
+            }
+        }
+
+        if (errors)
+            ESP_LOGE(TAG, "%-16s %lu of %d samples disagree with the float path", det->name,
+                     (unsigned long)errors, BENCH_ROUNDS * DETECTOR_BLOCK_SIZE);
+        else
+            ESP_LOGI(TAG, "%-16s matches the float path (%lu at the threshold)", det->name,
+                     (unsigned long)boundary);
+    }
+}
+
+static void log_filter_cost(const char *label, int64_t us, int64_t samples)
+{
+    // CPU time per second of readings at the sample and oversampled rates
+    int64_t ns = us * 1000 / samples;
+    ESP_LOGI(TAG, "%-16s %5lld ns  %5lld us/s at 100 Hz  %6lld us/s at 1 kHz  (per sample)",
+             label, ns, ns * 100 / 1000, ns);
+}
+
+// Detector input filter at its default order, designed for 1 kHz
+static void bench_biquad(void)
+{
+    static biquad_cascade_t filter;
+    int64_t samples = (int64_t)BENCH_ROUNDS * DETECTOR_BLOCK_SIZE;
+
+    biquad_design_lowpass(&filter, DETECTOR_FILTER_STAGES, 50.0f, 1000.0f);
+    const accel_t up = accel_from_g(0.2f), down = accel_from_g(-0.2f);
+    sensor_reading_t r = {.x = accel_from_g(0.1f), .y = down, .z = ACCEL_ONE_G};
+    int64_t start = esp_timer_get_time();
+    for (int64_t i = 0; i < samples; i++)
+    {
+        r.y = (i & 1) ? down : up;
+        biquad_process(&filter, &r);
+    }
+    log_filter_cost("biquad sample", esp_timer_get_time() - start, samples);
+
+#if !DETECTOR_FIXED_POINT
+    static float x[DETECTOR_BLOCK_SIZE], y[DETECTOR_BLOCK_SIZE], z[DETECTOR_BLOCK_SIZE];
+    float *const axis[BIQUAD_AXES] = {x, y, z};
+    biquad_design_lowpass(&filter, DETECTOR_FILTER_STAGES, 50.0f, 1000.0f);
+    start = esp_timer_get_time();
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for (int i = 0; i < DETECTOR_BLOCK_SIZE; i++)
+        {
+            x[i] = 0.1f;
+            y[i] = (i & 1) ? -0.2f : 0.2f;
+            z[i] = 1.0f;
+        }
+        biquad_process_block(&filter, axis, DETECTOR_BLOCK_SIZE);
+    }
+    log_filter_cost("biquad block", esp_timer_get_time() - start, samples);
+#endif
+}
+
+void trace_run_benchmarks(void)
+{
+    ESP_LOGI(TAG, "========== Benchmarks ==========");
+    bench_ring_buffer("rb mutex", RING_BUFFER_SYNC_MUTEX, false);
+    bench_ring_buffer("rb mutex bulk", RING_BUFFER_SYNC_MUTEX, true);
+    bench_ring_buffer("rb spsc", RING_BUFFER_SYNC_SPSC, false);
+    bench_ring_buffer("rb spsc bulk", RING_BUFFER_SYNC_SPSC, true);
+    bench_typed("typed mutex", &typed_mutex_ops, false);
+    bench_typed("typed mutex bulk", &typed_mutex_ops, true);
+    bench_typed("typed spsc", &typed_spsc_ops, false);
+    bench_typed("typed spsc bulk", &typed_spsc_ops, true);
+    // What sensor_rb costs: the typed queue behind a ring_buffer_t handle
+    run_ring_buffer("typed spsc rb", bench_typed_spsc_as_ring_buffer(), false);
+    run_ring_buffer("typed spsc rb bulk", bench_typed_spsc_as_ring_buffer(), true);
+    bench_detector_kernels();
+    check_detector_equivalence();
+    bench_biquad();
+    ESP_LOGI(TAG, "================================");
+}
+#else
+void trace_run_benchmarks(void) {}
+#endif
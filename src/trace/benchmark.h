@@ -0,0 +1,18 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Runs the microbenchmarks and logs the results. No-op unless
+    // TRACE_BENCHMARKS_ENABLED is set. Call before the tasks are created so
+    // the numbers are not skewed by preemption.
+    void trace_run_benchmarks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCHMARK_H
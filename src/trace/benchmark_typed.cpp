@@ -0,0 +1,10 @@
+#include "config.h"
+
+#if TRACE_BENCHMARKS_ENABLED
+#include "benchmark_typed.h"
+
+TYPED_RING_BUFFER_DEFINE(bench_typed_mutex, sensor_reading_t, BENCH_TYPED_CAPACITY,
+                         RING_BUFFER_SYNC_MUTEX)
+TYPED_RING_BUFFER_DEFINE(bench_typed_spsc, sensor_reading_t, BENCH_TYPED_CAPACITY,
+                         RING_BUFFER_SYNC_SPSC)
+#endif
@@ -0,0 +1,13 @@
+#ifndef BENCHMARK_TYPED_H
+#define BENCHMARK_TYPED_H
+
+#include "message_types.h"
+#include "queue/typed_ring_buffer.hpp"
+
+// Same capacity as sensor_rb, so a benchmark fill exactly fills it
+#define BENCH_TYPED_CAPACITY SENSOR_QUEUE_SIZE
+
+TYPED_RING_BUFFER_DECLARE(bench_typed_mutex, sensor_reading_t);
+TYPED_RING_BUFFER_DECLARE(bench_typed_spsc, sensor_reading_t);
+
+#endif // BENCHMARK_TYPED_H
@@ -4,6 +4,10 @@
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "message_types.h"
+#include "queue/ring_buffer.h"
+#include "queue/priority_queue.h"
+#include "sensor/sensor.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -48,6 +52,23 @@ void trace_log_switch(const char *task_name, bool is_switch_in)
 }
 
 #if TRACE_STATS_ENABLED
+static void print_queue_stats(const char *name, const ring_buffer_stats_t *s)
+{
+    printf("%-16s%-8lu%-8lu%-8lu%-8lu%-8lu%-8lu%-8lu%-6u%-6u%llu\n", name,
+           (unsigned long)s->pushes, (unsigned long)s->pops,
+           (unsigned long)s->overwrites, (unsigned long)s->rejected,
+           (unsigned long)s->block_timeouts, (unsigned long)s->coalesced,
+           (unsigned long)s->lock_failures, (unsigned)s->depth,
+           (unsigned)s->max_depth, (unsigned long long)s->lock_wait_us);
+}
+
+static void print_ring_buffer_stats(const char *name, ring_buffer_t *rb)
+{
+    ring_buffer_stats_t stats;
+    if (rb && ring_buffer_get_stats(rb, &stats))
+        print_queue_stats(name, &stats);
+}
+
 void trace_print_stats(void)
 {
     ESP_LOGI(TAG, "========== Task Runtime Stats ==========");
@@ -66,6 +87,34 @@ void trace_print_stats(void)
     printf("--------------------------------------------\n");
     printf("%s", stats_buffer);
     ESP_LOGI(TAG, "=================================");
+
+    ESP_LOGI(TAG, "========== Queue Stats ==========");
+    printf("Queue           Push    Pop     Overwr  Reject  Timeout Merged  LockErr Depth Max   Wait us\n");
+    printf("----------------------------------------------------------------------------------------------\n");
+    print_ring_buffer_stats("sensor_rb", sensor_rb);
+    print_ring_buffer_stats("batch_rb", batch_rb);
+    print_ring_buffer_stats("command_queue", mqtt_command_queue);
+    for (size_t lane = 0; mqtt_rb && lane < MQTT_LANE_COUNT; lane++) {
+        ring_buffer_stats_t stats;
+        char name[20];
+        snprintf(name, sizeof(name), "mqtt_rb/%s", mqtt_lane_to_string((mqtt_lane_t)lane));
+        if (priority_queue_get_lane_stats(mqtt_rb, lane, &stats))
+            print_queue_stats(name, &stats);
+    }
+    ESP_LOGI(TAG, "=================================");
+
+    sensor_timing_stats_t timing;
+    if (sensor_get_timing_stats(&timing)) {
+        ESP_LOGI(TAG, "========== Sample Timing ==========");
+        printf("Periods %lu, missed %lu, read errors %lu, expected %d us\n",
+               (unsigned long)timing.periods, (unsigned long)timing.missed,
+               (unsigned long)timing.read_errors,
+               1000000 / (sensor_get_sample_rate_hz() * sensor_get_oversample()));
+        printf("min %lu us, max %lu us, mean %.1f us, stddev %.1f us\n",
+               (unsigned long)timing.min_period_us, (unsigned long)timing.max_period_us,
+               timing.mean_period_us, timing.stddev_us);
+        ESP_LOGI(TAG, "===================================");
+    }
 }
 
 static void stats_task(void *pvParameters)